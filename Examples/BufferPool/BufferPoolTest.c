@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#include "FastBuffer.h"
+
+#define SIZE_MINIMUM   40
+#define SIZE_MAXIMUM   65536
+#define REPORT_COUNT   4
+
+// Mixed-size workload over FastBufferPool: a working set of buffers from 40 B to 64 KB (log-uniform) churned by random replacement.
+// memalign() is wrapped at link time (see Makefile), so every buffer the pool takes from the heap is counted.
+// Power-of-two classes (before four classes per power of two) would round every request up to the next power of two,
+// the wrapper sums that too, so one run shows heap footprint of both.
+
+void* __real_memalign(size_t alignment, size_t size);
+
+static uint64_t calls   = 0;
+static uint64_t bytes   = 0;
+static uint64_t rounded = 0;
+
+void* __wrap_memalign(size_t alignment, size_t size)
+{
+  calls   ++;
+  bytes   += size;
+  rounded += 1ULL << (64 - __builtin_clzll(size - 1));
+  return __real_memalign(alignment, size);
+}
+
+static uint32_t GetRandomSize(uint32_t* seed)
+{
+  uint32_t shift;
+  uint32_t size;
+
+  // Uniform over powers of two from 32 B to 32 KB, then uniform within the power
+
+  shift = 5 + rand_r(seed) % 11;
+  size  = (1U << shift) + rand_r(seed) % (1U << shift);
+
+  return (size < SIZE_MINIMUM) ? SIZE_MINIMUM : ((size > SIZE_MAXIMUM) ? SIZE_MAXIMUM : size);
+}
+
+static void PrintReport(struct FastBufferPool* pool, uint64_t operations, uint64_t allocations)
+{
+  struct FastBufferPoolStatistics statistics;
+
+  GetFastBufferPoolStatistics(pool, &statistics);
+
+  printf("%12llu %12llu %10.2f %10llu %12llu %12llu %8.3f\n",
+    (unsigned long long)operations,
+    (unsigned long long)calls,
+    (double)calls * 1000.0 / (double)allocations,
+    (unsigned long long)statistics.count,
+    (unsigned long long)statistics.size / 1024,
+    (unsigned long long)statistics.used / 1024,
+    (double)statistics.size / (double)statistics.used);
+}
+
+int main(int count, char** arguments)
+{
+  struct FastBufferPool* pool;
+  struct FastBuffer** buffers;
+  uint64_t allocations;
+  uint64_t operations;
+  uint64_t operation;
+  uint32_t length;
+  uint32_t index;
+  uint32_t seed;
+
+  length     = (count > 1) ? atoi(arguments[1]) : 4096;
+  operations = (count > 2) ? strtoull(arguments[2], NULL, 10) : 4000000;
+  seed       = 1;
+
+  if ((length     == 0) ||
+      (operations == 0))
+  {
+    printf("Usage: bufferpooltest [buffers in working set] [replacements]\n");
+    return 1;
+  }
+
+  pool    = CreateFastBufferPool(NULL);
+  buffers = (struct FastBuffer**)calloc(length, sizeof(struct FastBuffer*));
+
+  printf("Working set: %u buffers of %u..%u bytes, %llu replacements\n", length, SIZE_MINIMUM, SIZE_MAXIMUM, (unsigned long long)operations);
+  printf("%12s %12s %10s %10s %12s %12s %8s\n", "operations", "memalign", "per 1000", "count", "size KB", "used KB", "size/used");
+
+  for (index = 0; index < length; index ++)
+    buffers[index] = AllocateFastBuffer(pool, GetRandomSize(&seed), 0);
+
+  allocations = length;
+  PrintReport(pool, 0, allocations);
+
+  for (operation = 1; operation <= operations; operation ++)
+  {
+    index = rand_r(&seed) % length;
+
+    ReleaseFastBuffer(buffers[index]);
+    buffers[index] = AllocateFastBuffer(pool, GetRandomSize(&seed), 0);
+    allocations ++;
+
+    if ((operation % (operations / REPORT_COUNT + 1)) == 0)
+    {
+      //
+      PrintReport(pool, operation, allocations);
+    }
+  }
+
+  PrintReport(pool, operations, allocations);
+  printf("Heap requested by memalign: %llu KB, with power-of-two classes: %llu KB\n", (unsigned long long)bytes / 1024, (unsigned long long)rounded / 1024);
+
+  for (index = 0; index < length; index ++)
+    ReleaseFastBuffer(buffers[index]);
+
+  ReleaseFastBufferPool(pool);
+  free(buffers);
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FastRing.h"
+
+// Measures CQEs/s of WaitForFastRing() with batched CQ head advance (default) and per-CQE advance (RING_MODE_EARLY_ADVANCE)
+
+static int HandleCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  uint64_t* count;
+
+  count = (uint64_t*)descriptor->closure;
+  *count += (completion != NULL);
+  return 0;
+}
+
+static uint64_t GetTime()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+}
+
+static void Run(uint32_t mode, const char* name, uint32_t depth, uint64_t count)
+{
+  struct FastRingParameters parameters;
+  struct FastRingDescriptor* descriptor;
+  struct FastRing* ring;
+  uint64_t completed;
+  uint64_t submitted;
+  uint64_t time;
+  uint32_t index;
+
+  memset(&parameters, 0, sizeof(struct FastRingParameters));
+
+  parameters.length = depth;
+  parameters.mode   = mode;
+  parameters.cpu    = -1;
+
+  if ((ring = CreateFastRingEx(&parameters)) == NULL)
+  {
+    printf("%-14s not supported\n", name);
+    return;
+  }
+
+  completed = 0;
+  submitted = 0;
+  time      = GetTime();
+
+  while (completed < count)
+  {
+    // Submit a whole wave, so CQ is full of ready CQEs when WaitForFastRing() reaps them
+
+    for (index = 0; (index < depth) && (submitted < count); index ++, submitted ++)
+    {
+      descriptor = AllocateFastRingDescriptor(ring, HandleCompletion, &completed);
+
+      io_uring_prep_nop(&descriptor->submission);
+      SubmitFastRingDescriptor(descriptor, 0);
+    }
+
+    while ((completed < submitted) &&
+           (WaitForFastRing(ring, 1, NULL) >= 0));
+  }
+
+  time = GetTime() - time;
+
+  printf("%-14s %8.1f ns/CQE  %8.2f M CQEs/s\n", name, (double)time / count, (double)count * 1000.0 / time);
+
+  ReleaseFastRing(ring);
+}
+
+int main(int count, char** arguments)
+{
+  uint32_t depth;
+  uint32_t round;
+  uint32_t rounds;
+  uint64_t number;
+
+  depth  = (count > 1) ? atoi(arguments[1]) : 4096;
+  number = (count > 2) ? atoll(arguments[2]) : 1000000;
+  rounds = (count > 3) ? atoi(arguments[3]) : 3;
+
+  if ((depth  == 0) ||
+      (number == 0))
+  {
+    printf("Usage: completiontest [requests in flight] [NOPs] [rounds]\n");
+    return 1;
+  }
+
+  printf("%llu NOPs, %u in flight, RING_CQE_BATCH_LENGTH %d\n", (unsigned long long)number, depth, RING_CQE_BATCH_LENGTH);
+
+  for (round = 0; round < rounds; round ++)
+  {
+    // Modes are interleaved, so frequency scaling and noise hit both of them
+    Run(RING_MODE_DEFAULT,       "BATCHED",       depth, number);
+    Run(RING_MODE_EARLY_ADVANCE, "EARLY_ADVANCE", depth, number);
+  }
+
+  return 0;
+}
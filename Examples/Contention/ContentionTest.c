@@ -0,0 +1,149 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FastRing.h"
+
+#define BURST_LENGTH      16
+#define MAXIMUM_RINGS     64
+#define MAXIMUM_THREADS   256
+#define CHURN_ROUNDS      64
+
+struct Context
+{
+  struct FastRing* rings[MAXIMUM_RINGS];
+  uint32_t count;
+  uint32_t iterations;
+  pthread_barrier_t barrier;
+};
+
+static int HandleCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  // Descriptors are never submitted
+  return 0;
+}
+
+static uint64_t GetTime()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+}
+
+static void* DoWork(void* closure)
+{
+  struct Context* context;
+  struct FastRing* ring;
+  struct FastRingDescriptor* burst[BURST_LENGTH];
+  uint32_t iteration;
+  uint32_t index;
+
+  context = (struct Context*)closure;
+
+  pthread_barrier_wait(&context->barrier);
+
+  for (iteration = 0; iteration < context->iterations; iteration ++)
+  {
+    // Every thread walks all rings, more rings than 4 defeated the old direct-mapped TLS slots
+    ring = context->rings[iteration % context->count];
+
+    for (index = 0; index < BURST_LENGTH; index ++)
+      burst[index] = AllocateFastRingDescriptor(ring, HandleCompletion, NULL);
+
+    for (index = 0; index < BURST_LENGTH; index ++)
+      ReleaseFastRingDescriptor(burst[index]);
+  }
+
+  pthread_barrier_wait(&context->barrier);
+  return NULL;
+}
+
+static uint64_t Run(struct Context* context, uint32_t count)
+{
+  pthread_t threads[MAXIMUM_THREADS];
+  uint64_t time;
+  uint32_t index;
+
+  pthread_barrier_init(&context->barrier, NULL, count + 1);
+
+  for (index = 0; index < count; index ++)
+    pthread_create(threads + index, NULL, DoWork, context);
+
+  pthread_barrier_wait(&context->barrier);
+  time = GetTime();
+  pthread_barrier_wait(&context->barrier);
+  time = GetTime() - time;
+
+  for (index = 0; index < count; index ++)
+    pthread_join(threads[index], NULL);
+
+  pthread_barrier_destroy(&context->barrier);
+  return time;
+}
+
+static uint32_t GetCacheCount(struct FastRing* ring)
+{
+  struct FastRingCache* cache;
+  uint32_t count;
+
+  count = 0;
+
+  for (cache = atomic_load_explicit(&ring->descriptors.caches.top, memory_order_acquire); cache != NULL; cache = cache->next)
+    count ++;
+
+  return count;
+}
+
+int main(int count, char** arguments)
+{
+  struct Context context;
+  uint32_t threads;
+  uint32_t index;
+  uint64_t operations;
+  uint64_t time;
+
+  threads            = (count > 1) ? atoi(arguments[1]) : 4;
+  context.count      = (count > 2) ? atoi(arguments[2]) : 8;
+  context.iterations = (count > 3) ? atoi(arguments[3]) : 200000;
+
+  if ((threads       == 0) || (threads       > MAXIMUM_THREADS) ||
+      (context.count == 0) || (context.count > MAXIMUM_RINGS))
+  {
+    printf("Usage: contentiontest [threads (1-%d)] [rings (1-%d)] [iterations]\n", MAXIMUM_THREADS, MAXIMUM_RINGS);
+    return 1;
+  }
+
+  for (index = 0; index < context.count; index ++)
+    context.rings[index] = CreateFastRing(0);
+
+  // Steady state: long-living threads, caches stay warm
+
+  operations = (uint64_t)threads * context.iterations * BURST_LENGTH;
+  time       = Run(&context, threads);
+
+  printf("Steady: %u threads, %u rings, %.1f ns per allocate/release pair, %.2f M pairs/s\n",
+    threads, context.count, (double)time * threads / operations, (double)operations * 1000.0 / time);
+
+  // Churn: short-living threads, caches of exited threads have to be flushed and reused
+
+  context.iterations = context.count * 16;
+  operations         = 0;
+  time               = 0;
+
+  for (index = 0; index < CHURN_ROUNDS; index ++)
+  {
+    operations += (uint64_t)threads * context.iterations * BURST_LENGTH;
+    time       += Run(&context, threads);
+  }
+
+  // Every cache holds up to RING_DESC_CACHE_LENGTH descriptors, caches of exited threads must not pile up
+
+  printf("Churn: %u rounds of %u threads, %.1f ns per allocate/release pair, %u per-thread caches on the first ring\n",
+    CHURN_ROUNDS, threads, (double)time * threads / operations, GetCacheCount(context.rings[0]));
+
+  for (index = 0; index < context.count; index ++)
+    ReleaseFastRing(context.rings[index]);
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "FastRing.h"
+
+#define COUNTER_COUNT  3
+
+// Measures submission and completion loops of WaitForFastRing() with many descriptors in flight.
+// The program uses only API which predates the compact layout, build it against an older tree to compare.
+
+struct Counters
+{
+  int handles[COUNTER_COUNT];
+  uint64_t values[COUNTER_COUNT];
+};
+
+static const char* names[COUNTER_COUNT] =
+{
+  "L1D misses",
+  "LLC misses",
+  "dTLB misses"
+};
+
+static const uint64_t configurations[COUNTER_COUNT] =
+{
+  PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+  PERF_COUNT_HW_CACHE_LL  | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+  PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+};
+
+static int HandleCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  uint64_t* count;
+
+  count = (uint64_t*)descriptor->closure;
+  *count += (completion != NULL);
+  return 0;
+}
+
+static uint64_t GetTime()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+}
+
+static void OpenCounters(struct Counters* counters)
+{
+  struct perf_event_attr attribute;
+  uint32_t index;
+
+  for (index = 0; index < COUNTER_COUNT; index ++)
+  {
+    memset(&attribute, 0, sizeof(struct perf_event_attr));
+
+    // Only user space is counted, kernel side of io_uring does not depend on the descriptor layout
+    attribute.size           = sizeof(struct perf_event_attr);
+    attribute.type           = PERF_TYPE_HW_CACHE;
+    attribute.config         = configurations[index];
+    attribute.disabled       = 1;
+    attribute.exclude_kernel = 1;
+    attribute.exclude_hv     = 1;
+
+    counters->handles[index] = syscall(SYS_perf_event_open, &attribute, 0, -1, -1, 0);
+    counters->values[index]  = 0;
+  }
+}
+
+static void ControlCounters(struct Counters* counters, int request)
+{
+  uint32_t index;
+
+  for (index = 0; index < COUNTER_COUNT; index ++)
+  {
+    if (counters->handles[index] >= 0)
+    {
+      //
+      ioctl(counters->handles[index], request, 0);
+    }
+  }
+}
+
+static void CloseCounters(struct Counters* counters)
+{
+  uint32_t index;
+
+  for (index = 0; index < COUNTER_COUNT; index ++)
+  {
+    if ((counters->handles[index] >= 0) &&
+        (read(counters->handles[index], counters->values + index, sizeof(uint64_t)) != sizeof(uint64_t)))
+    {
+      // Counter is not readable, report it as not supported
+      close(counters->handles[index]);
+      counters->handles[index] = -1;
+    }
+
+    if (counters->handles[index] >= 0)
+    {
+      //
+      close(counters->handles[index]);
+    }
+  }
+}
+
+int main(int count, char** arguments)
+{
+  struct Counters counters;
+  struct FastRing* ring;
+  struct FastRingDescriptor* descriptor;
+  uint64_t completed;
+  uint64_t expected;
+  uint64_t time;
+  uint32_t length;
+  uint32_t rounds;
+  uint32_t round;
+  uint32_t index;
+
+  length = (count > 1) ? atoi(arguments[1]) : 32768;
+  rounds = (count > 2) ? atoi(arguments[2]) : 64;
+
+  if ((length == 0) ||
+      (rounds == 0))
+  {
+    printf("Usage: layouttest [descriptors in flight] [rounds]\n");
+    return 1;
+  }
+
+  ring      = CreateFastRing(length);
+  completed = 0;
+  expected  = 0;
+  time      = 0;
+
+  printf("Descriptor: %zu bytes, %u in flight (%zu KB of descriptors)\n", sizeof(struct FastRingDescriptor), length, (size_t)length * sizeof(struct FastRingDescriptor) / 1024);
+
+  // First round maps and touches all descriptors, it is not measured
+
+  for (round = 0; round <= rounds; round ++)
+  {
+    if (round == 1)
+    {
+      OpenCounters(&counters);
+      ControlCounters(&counters, PERF_EVENT_IOC_ENABLE);
+      time = GetTime();
+    }
+
+    for (index = 0; index < length; index ++)
+    {
+      descriptor = AllocateFastRingDescriptor(ring, HandleCompletion, &completed);
+
+      io_uring_prep_nop(&descriptor->submission);
+      SubmitFastRingDescriptor(descriptor, 0);
+    }
+
+    expected += length;
+
+    while ((completed < expected) &&
+           (WaitForFastRing(ring, 1, NULL) >= 0));
+  }
+
+  time = GetTime() - time;
+
+  ControlCounters(&counters, PERF_EVENT_IOC_DISABLE);
+  CloseCounters(&counters);
+
+  printf("Throughput: %.1f ns per NOP submit/complete cycle, %.2f M cycles/s\n", (double)time / ((double)length * rounds), (double)length * rounds * 1000.0 / time);
+
+  for (index = 0; index < COUNTER_COUNT; index ++)
+  {
+    if (counters.handles[index] < 0)
+    {
+      printf("%s: not supported\n", names[index]);
+      continue;
+    }
+
+    printf("%s: %.2f per descriptor\n", names[index], (double)counters.values[index] / ((double)length * rounds));
+  }
+
+  ReleaseFastRing(ring);
+  return 0;
+}
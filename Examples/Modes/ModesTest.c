@@ -0,0 +1,247 @@
+#define _GNU_SOURCE
+
+#include <time.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <linux/perf_event.h>
+
+#include "FastRing.h"
+
+#define COUNTER_COUNT  2
+#define BUFFER_SIZE    64
+
+// Counts syscalls per operation for every ring mode, tracepoint counters need perf_event_paranoid <= -1 or CAP_PERFMON
+
+struct Context
+{
+  struct FastRing* ring;
+  uint64_t remaining;
+  uint64_t completed;
+  uint32_t opcode;
+  int handle;
+  char buffer[BUFFER_SIZE];
+};
+
+static const char* tracepoints[COUNTER_COUNT] =
+{
+  "raw_syscalls/sys_enter",
+  "syscalls/sys_enter_io_uring_enter"
+};
+
+static const char* locations[] =
+{
+  "/sys/kernel/tracing/events",
+  "/sys/kernel/debug/tracing/events",
+  NULL
+};
+
+static int OpenTracepointCounter(const char* name)
+{
+  struct perf_event_attr attribute;
+  const char** location;
+  char path[PATH_MAX];
+  FILE* file;
+  int identifier;
+
+  identifier = -1;
+
+  for (location = locations; (*location != NULL) && (identifier < 0); location ++)
+  {
+    snprintf(path, PATH_MAX, "%s/%s/id", *location, name);
+
+    if (file = fopen(path, "r"))
+    {
+      identifier = (fscanf(file, "%d", &identifier) == 1) ? identifier : -1;
+      fclose(file);
+    }
+  }
+
+  if (identifier < 0)
+  {
+    // Tracefs is not mounted or not accessible
+    return -1;
+  }
+
+  memset(&attribute, 0, sizeof(struct perf_event_attr));
+
+  // Only the calling thread is counted, SQ polling thread is kernel's one and makes no syscalls
+  attribute.size     = sizeof(struct perf_event_attr);
+  attribute.type     = PERF_TYPE_TRACEPOINT;
+  attribute.config   = identifier;
+  attribute.disabled = 1;
+
+  return syscall(SYS_perf_event_open, &attribute, 0, -1, -1, 0);
+}
+
+static uint64_t ReadCounter(int handle)
+{
+  uint64_t value;
+
+  if ((handle < 0) ||
+      (read(handle, &value, sizeof(uint64_t)) != sizeof(uint64_t)))
+  {
+    //
+    return UINT64_MAX;
+  }
+
+  return value;
+}
+
+static uint64_t GetTime()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+}
+
+static int HandleCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason);
+
+static int SubmitOperation(struct Context* context)
+{
+  struct FastRingDescriptor* descriptor;
+
+  if (descriptor = AllocateFastRingDescriptor(context->ring, HandleCompletion, context))
+  {
+    switch (context->opcode)
+    {
+      case IORING_OP_NOP:    io_uring_prep_nop(&descriptor->submission);                                                  break;
+      case IORING_OP_WRITE:  io_uring_prep_write(&descriptor->submission, context->handle, context->buffer, BUFFER_SIZE, 0);  break;
+    }
+
+    SubmitFastRingDescriptor(descriptor, 0);
+    return 0;
+  }
+
+  return -ENOMEM;
+}
+
+static int HandleCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  struct Context* context;
+
+  context = (struct Context*)descriptor->closure;
+
+  if (completion != NULL)
+  {
+    context->completed ++;
+
+    if (context->remaining > 0)
+    {
+      // Keep the depth of the queue constant
+      context->remaining --;
+      SubmitOperation(context);
+    }
+  }
+
+  return 0;
+}
+
+static void Run(uint32_t mode, const char* name, uint32_t opcode, uint32_t depth, uint64_t count)
+{
+  struct FastRingParameters parameters;
+  struct Context context;
+  struct rusage before;
+  struct rusage after;
+  int handles[COUNTER_COUNT];
+  uint64_t values[COUNTER_COUNT];
+  uint64_t time;
+  uint32_t index;
+
+  memset(&parameters, 0, sizeof(struct FastRingParameters));
+  memset(&context, 0, sizeof(struct Context));
+
+  parameters.length = depth * 2;
+  parameters.mode   = mode;
+  parameters.cpu    = -1;
+
+  if ((context.ring = CreateFastRingEx(&parameters)) == NULL)
+  {
+    printf("%-14s %-6s not supported\n", name, (opcode == IORING_OP_NOP) ? "NOP" : "WRITE");
+    return;
+  }
+
+  context.opcode    = opcode;
+  context.handle    = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  context.remaining = count - depth;
+
+  for (index = 0; index < COUNTER_COUNT; index ++)
+    handles[index] = OpenTracepointCounter(tracepoints[index]);
+
+  for (index = 0; index < depth; index ++)
+    SubmitOperation(&context);
+
+  getrusage(RUSAGE_THREAD, &before);
+
+  for (index = 0; index < COUNTER_COUNT; index ++)
+    ioctl(handles[index], PERF_EVENT_IOC_ENABLE, 0);
+
+  time = GetTime();
+
+  while ((context.completed < count) &&
+         (WaitForFastRing(context.ring, 100, NULL) >= 0));
+
+  time = GetTime() - time;
+
+  for (index = 0; index < COUNTER_COUNT; index ++)
+  {
+    ioctl(handles[index], PERF_EVENT_IOC_DISABLE, 0);
+    values[index] = ReadCounter(handles[index]);
+    close(handles[index]);
+  }
+
+  getrusage(RUSAGE_THREAD, &after);
+
+  printf("%-14s %-6s %7.1f ns/op  ", name, (opcode == IORING_OP_NOP) ? "NOP" : "WRITE", (double)time / count);
+
+  for (index = 0; index < COUNTER_COUNT; index ++)
+  {
+    if (values[index] == UINT64_MAX)
+    {
+      printf("%10s  ", "n/a");
+      continue;
+    }
+
+    printf("%10.4f  ", (double)values[index] / count);
+  }
+
+  printf("%10.4f\n", (double)((after.ru_nvcsw + after.ru_nivcsw) - (before.ru_nvcsw + before.ru_nivcsw)) / count);
+
+  close(context.handle);
+  ReleaseFastRing(context.ring);
+}
+
+int main(int count, char** arguments)
+{
+  uint32_t depth;
+  uint64_t number;
+
+  depth  = (count > 1) ? atoi(arguments[1]) : 32;
+  number = (count > 2) ? atoll(arguments[2]) : 1000000;
+
+  if ((depth  == 0) ||
+      (number <= depth))
+  {
+    printf("Usage: modestest [requests in flight] [operations]\n");
+    return 1;
+  }
+
+  printf("%u requests in flight, %llu operations, values are per operation\n", depth, (unsigned long long)number);
+  printf("%-14s %-6s %13s  %10s  %10s  %10s\n", "Mode", "Op", "Time", "Syscalls", "Enters", "Switches");
+
+  Run(RING_MODE_DEFAULT,       "DEFAULT",       IORING_OP_NOP,   depth, number);
+  Run(RING_MODE_SQPOLL,        "SQPOLL",        IORING_OP_NOP,   depth, number);
+  Run(RING_MODE_DEFER_TASKRUN, "DEFER_TASKRUN", IORING_OP_NOP,   depth, number);
+  Run(RING_MODE_DEFAULT,       "DEFAULT",       IORING_OP_WRITE, depth, number);
+  Run(RING_MODE_SQPOLL,        "SQPOLL",        IORING_OP_WRITE, depth, number);
+  Run(RING_MODE_DEFER_TASKRUN, "DEFER_TASKRUN", IORING_OP_WRITE, depth, number);
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FastRing.h"
+
+#define OBJECT_STRIDE  4096
+
+// Measures completion handling with cold descriptors and closures.
+// CQEs are posted by msg_ring from another ring, so the target ring doesn't touch its descriptors before it reaps them,
+// caches are flushed by walking a large buffer between posting and reaping.
+// Prefetch distance is a compile-time tunable: make clean && make DISTANCE=16
+
+struct Object
+{
+  uint64_t value;
+};
+
+struct Context
+{
+  uint64_t completed;
+  uint64_t sum;
+};
+
+static struct Context context;
+
+static int HandleEvent(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  struct Object* object;
+
+  if (completion != NULL)
+  {
+    // Handler touches its closure as a real one would, event is kept for the next round
+    object       = (struct Object*)descriptor->closure;
+    context.sum += ++ object->value;
+    context.completed ++;
+    return 1;
+  }
+
+  return 0;
+}
+
+static uint64_t GetTime()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+}
+
+static void FlushCaches(uint8_t* buffer, size_t size)
+{
+  size_t position;
+
+  for (position = 0; position < size; position += 64)
+  {
+    //
+    buffer[position] ++;
+  }
+}
+
+int main(int count, char** arguments)
+{
+  struct FastRingDescriptor** events;
+  struct FastRing* source;
+  struct FastRing* target;
+  uint8_t* objects;
+  uint8_t* buffer;
+  uint32_t* order;
+  uint32_t length;
+  uint32_t rounds;
+  uint32_t round;
+  uint32_t index;
+  uint32_t other;
+  uint32_t value;
+  uint64_t expected;
+  uint64_t start;
+  uint64_t time;
+  size_t size;
+
+  length = (count > 1) ? atoi(arguments[1]) : 4096;
+  rounds = (count > 2) ? atoi(arguments[2]) : 200;
+  size   = (count > 3) ? (size_t)atoi(arguments[3]) << 20 : (64ULL << 20);
+
+  if ((length == 0) ||
+      (rounds == 0))
+  {
+    printf("Usage: prefetchtest [CQEs per round] [rounds] [flush buffer in MB]\n");
+    return 1;
+  }
+
+  // CQ of the target holds a whole round, so no CQE goes to the overflow list
+
+  source  = CreateFastRing(length);
+  target  = CreateFastRing(length);
+  events  = (struct FastRingDescriptor**)calloc(length, sizeof(struct FastRingDescriptor*));
+  order   = (uint32_t*)calloc(length, sizeof(uint32_t));
+  objects = (uint8_t*)calloc(length, OBJECT_STRIDE);
+  buffer  = (uint8_t*)calloc(1, size);
+
+  for (index = 0; index < length; index ++)
+  {
+    events[index] = CreateFastRingEvent(target, HandleEvent, objects + (size_t)index * OBJECT_STRIDE);
+    order[index]  = index;
+  }
+
+  srand(length);
+
+  for (index = length - 1; index > 0; index --)
+  {
+    // Random order of CQEs defeats hardware prefetcher, only software prefetch can help
+    other        = rand() % (index + 1);
+    value        = order[index];
+    order[index] = order[other];
+    order[other] = value;
+  }
+
+  time     = 0;
+  expected = 0;
+
+  for (round = 0; round <= rounds; round ++)
+  {
+    for (index = 0; index < length; index ++)
+      SubmitFastRingEvent(source, events[order[index]], 0, 0);
+
+    // Submit messages, completions of msg_ring on the source are handled here too
+    WaitForFastRing(source, 0, NULL);
+
+    expected += length;
+
+    FlushCaches(buffer, size);
+
+    start = GetTime();
+
+    while ((context.completed < expected) &&
+           (WaitForFastRing(target, 1, NULL) >= 0));
+
+    // The first round warms up TLB and page tables, it is not measured
+    time += (round > 0) ? (GetTime() - start) : 0;
+  }
+
+  printf("RING_CQE_PREFETCH_DISTANCE %d, RING_CQE_BATCH_LENGTH %d, %u CQEs per round: %.1f ns per cold CQE\n",
+    RING_CQE_PREFETCH_DISTANCE, RING_CQE_BATCH_LENGTH, length, (double)time / ((double)length * rounds));
+
+  for (index = 0; index < length; index ++)
+    ReleaseFastRingDescriptor(events[index]);
+
+  ReleaseFastRing(source);
+  ReleaseFastRing(target);
+
+  free(buffer);
+  free(objects);
+  free(order);
+  free(events);
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+#define _GNU_SOURCE
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "FastRing.h"
+
+// Measures wake-ups of the ring thread per second with many repeating timers for several values of SetFastRingTimerSlack()
+
+struct Context
+{
+  uint64_t firings;
+  uint64_t delay;
+};
+
+static struct Context context;
+
+static uint64_t GetTime()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000ULL + (uint64_t)time.tv_nsec / 1000000ULL;
+}
+
+static void HandleTimer(struct FastRingTimer* timer, void* closure)
+{
+  uint64_t* expected;
+  uint64_t time;
+
+  // Timer is already re-armed, closure keeps the tick it was expected at
+
+  expected  = (uint64_t*)closure;
+  time      = GetTime();
+
+  context.firings ++;
+  context.delay  += (time > *expected) ? (time - *expected) : 0;
+  *expected      += timer->interval;
+}
+
+static void Run(uint32_t count, uint32_t slack, uint32_t duration)
+{
+  struct FastRingTimer* timers;
+  struct FastRing* ring;
+  struct rusage before;
+  struct rusage after;
+  uint64_t* expectations;
+  uint64_t wakeups;
+  uint64_t previous;
+  uint64_t start;
+  uint64_t time;
+  uint32_t interval;
+  uint32_t index;
+
+  ring         = CreateFastRing(0);
+  timers       = (struct FastRingTimer*)calloc(count, sizeof(struct FastRingTimer));
+  expectations = (uint64_t*)calloc(count, sizeof(uint64_t));
+
+  memset(&context, 0, sizeof(struct Context));
+  SetFastRingTimerSlack(ring, slack);
+  srand(count);
+
+  start = GetTime();
+
+  for (index = 0; index < count; index ++)
+  {
+    // Intervals from 100 ms to 2 s, like connection keep-alives and retransmissions
+    interval            = 100 + rand() % 1900;
+    expectations[index] = start + interval;
+
+    SetFastRingTimer(ring, timers + index, interval, RING_TIMER_FLAG_REPEAT, HandleTimer, expectations + index);
+  }
+
+  wakeups = 0;
+
+  getrusage(RUSAGE_THREAD, &before);
+
+  while ((time = GetTime()) < start + duration * 1000ULL)
+  {
+    // Every return with fired timers is a wake-up caused by the wheel
+    previous = context.firings;
+    WaitForFastRing(ring, 1000, NULL);
+    wakeups += (context.firings != previous);
+  }
+
+  getrusage(RUSAGE_THREAD, &after);
+
+  printf("%8u ms  %10.1f  %10.1f  %10.1f  %10.2f\n",
+    slack,
+    (double)wakeups * 1000.0 / (time - start),
+    (double)((after.ru_nvcsw + after.ru_nivcsw) - (before.ru_nvcsw + before.ru_nivcsw)) * 1000.0 / (time - start),
+    (double)context.firings * 1000.0 / (time - start),
+    context.firings ? (double)context.delay / context.firings : 0.0);
+
+  for (index = 0; index < count; index ++)
+    CancelFastRingTimer(ring, timers + index);
+
+  ReleaseFastRing(ring);
+  free(expectations);
+  free(timers);
+}
+
+int main(int count, char** arguments)
+{
+  static const uint32_t slacks[] = { 0, 1, 4, 16, 64, 256 };
+
+  uint32_t duration;
+  uint32_t number;
+  uint32_t index;
+
+  number   = (count > 1) ? atoi(arguments[1]) : 10000;
+  duration = (count > 2) ? atoi(arguments[2]) : 10;
+
+  if ((number   == 0) ||
+      (duration == 0))
+  {
+    printf("Usage: timerslacktest [repeating timers] [seconds per slack]\n");
+    return 1;
+  }
+
+  printf("%u repeating timers, %u s per slack\n", number, duration);
+  printf("%11s  %10s  %10s  %10s  %10s\n", "Slack", "Wake-ups/s", "Switches/s", "Firings/s", "Delay, ms");
+
+  for (index = 0; index < sizeof(slacks) / sizeof(slacks[0]); index ++)
+  {
+    //
+    Run(number, slacks[index], duration);
+  }
+
+  return 0;
+}
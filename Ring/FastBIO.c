@@ -12,14 +12,14 @@
 #define likely(condition)    __builtin_expect(!!(condition), 1)
 #define unlikely(condition)  __builtin_expect(!!(condition), 0)
 
-_Static_assert(sizeof(struct tls12_crypto_info_aes_ccm_128)       <= sizeof(union FastRingData), "tls12_crypto_info_aes_ccm_128 must fit in FastRingData");
-_Static_assert(sizeof(struct tls12_crypto_info_aes_gcm_128)       <= sizeof(union FastRingData), "tls12_crypto_info_aes_gcm_128 must fit in FastRingData");
-_Static_assert(sizeof(struct tls12_crypto_info_aes_gcm_256)       <= sizeof(union FastRingData), "tls12_crypto_info_aes_gcm_256 must fit in FastRingData");
-_Static_assert(sizeof(struct tls12_crypto_info_chacha20_poly1305) <= sizeof(union FastRingData), "tls12_crypto_info_chacha20_poly1305 must fit in FastRingData");
-_Static_assert(sizeof(struct tls12_crypto_info_sm4_ccm)           <= sizeof(union FastRingData), "tls12_crypto_info_sm4_ccm must fit in FastRingData");
-_Static_assert(sizeof(struct tls12_crypto_info_sm4_gcm)           <= sizeof(union FastRingData), "tls12_crypto_info_sm4_gcm must fit in FastRingData");
-_Static_assert(sizeof(struct tls12_crypto_info_aria_gcm_128)      <= sizeof(union FastRingData), "tls12_crypto_info_aria_gcm_128 must fit in FastRingData");
-_Static_assert(sizeof(struct tls12_crypto_info_aria_gcm_256)      <= sizeof(union FastRingData), "tls12_crypto_info_aria_gcm_256 must fit in FastRingData");
+_Static_assert(sizeof(struct tls12_crypto_info_aes_ccm_128)       <= sizeof(union FastRingExtension), "tls12_crypto_info_aes_ccm_128 must fit in FastRingExtension");
+_Static_assert(sizeof(struct tls12_crypto_info_aes_gcm_128)       <= sizeof(union FastRingExtension), "tls12_crypto_info_aes_gcm_128 must fit in FastRingExtension");
+_Static_assert(sizeof(struct tls12_crypto_info_aes_gcm_256)       <= sizeof(union FastRingExtension), "tls12_crypto_info_aes_gcm_256 must fit in FastRingExtension");
+_Static_assert(sizeof(struct tls12_crypto_info_chacha20_poly1305) <= sizeof(union FastRingExtension), "tls12_crypto_info_chacha20_poly1305 must fit in FastRingExtension");
+_Static_assert(sizeof(struct tls12_crypto_info_sm4_ccm)           <= sizeof(union FastRingExtension), "tls12_crypto_info_sm4_ccm must fit in FastRingExtension");
+_Static_assert(sizeof(struct tls12_crypto_info_sm4_gcm)           <= sizeof(union FastRingExtension), "tls12_crypto_info_sm4_gcm must fit in FastRingExtension");
+_Static_assert(sizeof(struct tls12_crypto_info_aria_gcm_128)      <= sizeof(union FastRingExtension), "tls12_crypto_info_aria_gcm_128 must fit in FastRingExtension");
+_Static_assert(sizeof(struct tls12_crypto_info_aria_gcm_256)      <= sizeof(union FastRingExtension), "tls12_crypto_info_aria_gcm_256 must fit in FastRingExtension");
 
 // Supplementary
 
@@ -191,7 +191,6 @@ static int HandlePollCompletion(struct FastRingDescriptor* descriptor, struct io
 static int HandleInboundCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
 {
   int length;
-  uint8_t* data;
   struct msghdr* message;
   struct FastBIO* engine;
   struct FastBuffer* buffer;
@@ -245,12 +244,9 @@ static int HandleInboundCompletion(struct FastRingDescriptor* descriptor, struct
   }
 
   if (likely((completion->res > 0) &&
-             (data = GetFastRingBuffer(engine->inbound.provider, completion))))
+             (buffer = TakeProvidedFastBuffer(engine->inbound.provider, engine->inbound.pool, completion))))
   {
-    AdvanceFastRingBuffer(engine->inbound.provider, completion, AllocateRingFastBuffer, engine->inbound.pool);
-
-    message = &descriptor->data.socket.message;
-    buffer  = FAST_BUFFER(data);
+    message = &descriptor->extension->socket.message;
 
     if (unlikely((descriptor->submission.opcode != IORING_OP_RECVMSG) ||
                  !(output = io_uring_recvmsg_validate(buffer->data, completion->res, message)) ||
@@ -304,14 +300,14 @@ static int HandleOutboundCompletion(struct FastRingDescriptor* descriptor, struc
     goto Continue;
   }
 
-  if (( descriptor->data.socket.number == 0ULL) &&
+  if (( descriptor->extension->socket.number == 0ULL) &&
       ((descriptor->submission.flags & (IOSQE_IO_LINK | IOSQE_IO_HARDLINK)) == 0) &&
-      ( engine->outbound.condition   & POLLOUT))
+      ( engine->outbound.condition           & POLLOUT))
   {
     // In case of TCP the kernel may occupy a buffer for much longer,
     // notify handler once about accepted buffer as soon as possible
-    descriptor->data.socket.number ++;
-    engine->outbound.condition     &= ~POLLOUT;
+    descriptor->extension->socket.number ++;
+    engine->outbound.condition           &= ~POLLOUT;
     CallHandlerFunction(engine, POLLOUT, 0);
   }
 
@@ -320,7 +316,7 @@ static int HandleOutboundCompletion(struct FastRingDescriptor* descriptor, struc
   if ((completion == NULL) ||
       (~completion->flags & IORING_CQE_F_MORE))
   {
-    ReleaseFastBuffer(FAST_BUFFER(descriptor->data.socket.vector.iov_base));
+    ReleaseFastBuffer(FAST_BUFFER(descriptor->extension->socket.vector.iov_base));
     ReleaseEngine(engine, reason);
     return 0;
   }
@@ -345,7 +341,7 @@ static int HandleOptionCompletion(struct FastRingDescriptor* descriptor, struct
   }
 
   if (((descriptor->submission.flags & (IOSQE_IO_LINK | IOSQE_IO_HARDLINK)) == 0) &&
-      ( engine->outbound.condition   & POLLOUT))
+      ( engine->outbound.condition           & POLLOUT))
   {
     engine->outbound.condition &= ~POLLOUT;
     CallHandlerFunction(engine, POLLOUT, 0);
@@ -457,16 +453,17 @@ static int SetKernelTransmitter(struct FastBIO* engine, struct tls_crypto_info*
 
   if (unlikely(!(length         = GetTLSInformationLength(information)) ||
                !(descriptors[0] = AllocateFastRingDescriptor(engine->ring, HandleOptionCompletion, engine)) ||
-               !(descriptors[1] = AllocateFastRingDescriptor(engine->ring, HandleOptionCompletion, engine))))
+               !(descriptors[1] = AllocateFastRingDescriptor(engine->ring, HandleOptionCompletion, engine)) ||
+               !(GetFastRingDescriptorExtension(descriptors[1]))))
   {
     ReleaseFastRingDescriptor(descriptors[0]);
     ReleaseFastRingDescriptor(descriptors[1]);
     return 0;
   }
 
-  memcpy(&descriptors[1]->data, information, length);
+  memcpy(descriptors[1]->extension->data, information, length);
   io_uring_prep_cmd_sock(&descriptors[0]->submission, SOCKET_URING_OP_SETSOCKOPT, engine->handle, SOL_TCP, TCP_ULP, (void*)option, sizeof(option));
-  io_uring_prep_cmd_sock(&descriptors[1]->submission, SOCKET_URING_OP_SETSOCKOPT, engine->handle, SOL_TLS, TLS_TX, &descriptors[1]->data, length);
+  io_uring_prep_cmd_sock(&descriptors[1]->submission, SOCKET_URING_OP_SETSOCKOPT, engine->handle, SOL_TLS, TLS_TX, descriptors[1]->extension->data, length);
   PrepareFastRingDescriptor(descriptors[0], 0);
   PrepareFastRingDescriptor(descriptors[1], 0);
 
@@ -587,7 +584,7 @@ static int HandleBIORead(BIO* handle, char* destination, int size)
     return -1;
   }
 
-  message = &descriptor->data.socket.message;
+  message = &descriptor->extension->socket.message;
   start   = destination;
 
   // kTLS record mode
@@ -692,13 +689,13 @@ static int HandleBIOWrite(BIO* handle, const char* data, int length)
       (descriptor = engine->outbound.head)      &&
       (descriptor->function == HandleOutboundCompletion))
   {
-    buffer = FAST_BUFFER(descriptor->data.socket.vector.iov_base);
-    size   = descriptor->data.socket.vector.iov_len + length;
+    buffer = FAST_BUFFER(descriptor->extension->socket.vector.iov_base);
+    size   = descriptor->extension->socket.vector.iov_len + length;
 
     if (size <= buffer->size)
     {
-      memcpy(buffer->data + descriptor->data.socket.vector.iov_len, data, length);
-      descriptor->data.socket.vector.iov_len = size;
+      memcpy(buffer->data + descriptor->extension->socket.vector.iov_len, data, length);
+      descriptor->extension->socket.vector.iov_len = size;
       return length;
     }
   }
@@ -725,7 +722,8 @@ static int HandleBIOWrite(BIO* handle, const char* data, int length)
   descriptor  = AllocateFastRingDescriptor(engine->ring, HandleOutboundCompletion, engine);
 
   if (unlikely((buffer     == NULL) ||
-               (descriptor == NULL)))
+               (descriptor == NULL) ||
+               (GetFastRingDescriptorExtension(descriptor) == NULL)))
   {
     ReleaseFastBuffer(buffer);
     ReleaseFastRingDescriptor(descriptor);
@@ -735,23 +733,23 @@ static int HandleBIOWrite(BIO* handle, const char* data, int length)
   }
 
   memcpy(buffer->data, data, length);
-  memset(&descriptor->data.socket.message, 0, sizeof(struct msghdr));
+  memset(&descriptor->extension->socket.message, 0, sizeof(struct msghdr));
 
-  descriptor->data.socket.number             = 0ULL;
-  descriptor->data.socket.vector.iov_base    = buffer->data;
-  descriptor->data.socket.vector.iov_len     = length;
-  descriptor->data.socket.message.msg_iov    = &descriptor->data.socket.vector;
-  descriptor->data.socket.message.msg_iovlen = 1;
+  descriptor->extension->socket.number             = 0ULL;
+  descriptor->extension->socket.vector.iov_base    = buffer->data;
+  descriptor->extension->socket.vector.iov_len     = length;
+  descriptor->extension->socket.message.msg_iov    = &descriptor->extension->socket.vector;
+  descriptor->extension->socket.message.msg_iovlen = 1;
 
   if (unlikely(engine->type != 0))
   {
     value = (length + __BIGGEST_ALIGNMENT__ - 1) & ~(__BIGGEST_ALIGNMENT__ - 1);
-    descriptor->data.socket.message.msg_control    = buffer->data + value;
-    descriptor->data.socket.message.msg_controllen = CMSG_SPACE(sizeof(uint8_t));
+    descriptor->extension->socket.message.msg_control    = buffer->data + value;
+    descriptor->extension->socket.message.msg_controllen = CMSG_SPACE(sizeof(uint8_t));
 
-    memset(descriptor->data.socket.message.msg_control, 0, descriptor->data.socket.message.msg_controllen);
+    memset(descriptor->extension->socket.message.msg_control, 0, descriptor->extension->socket.message.msg_controllen);
 
-    control             = CMSG_FIRSTHDR(&descriptor->data.socket.message);
+    control             = CMSG_FIRSTHDR(&descriptor->extension->socket.message);
     control->cmsg_level = SOL_TLS;
     control->cmsg_type  = TLS_SET_RECORD_TYPE;
     control->cmsg_len   = CMSG_LEN(sizeof(uint8_t));
@@ -759,10 +757,10 @@ static int HandleBIOWrite(BIO* handle, const char* data, int length)
     *(uint8_t*)CMSG_DATA(control) = engine->type;
     engine->type                  = 0;
 
-    descriptor->data.socket.message.msg_controllen = control->cmsg_len;
+    descriptor->extension->socket.message.msg_controllen = control->cmsg_len;
   }
 
-  io_uring_prep_sendmsg_zc(&descriptor->submission, engine->handle, &descriptor->data.socket.message, 0);
+  io_uring_prep_sendmsg_zc(&descriptor->submission, engine->handle, &descriptor->extension->socket.message, 0);
 
   // Once this socket is kTLS-capable, never use regular SENDMSG_ZC
   descriptor->submission.opcode -= (IORING_OP_SENDMSG_ZC - IORING_OP_SENDMSG) * !!(engine->flags & FASTBIO_FLAG_KTLS_AVAILABLE);
@@ -993,7 +991,8 @@ BIO* CreateFastBIO(struct FastRing* ring, struct FastRingBufferProvider* provide
       (instance       = BIO_new(method)) &&
       (engine         = (struct FastBIO*)calloc(1, sizeof(struct FastBIO))) &&
       (descriptors[0] = AllocateFastRingDescriptor(ring, HandlePollCompletion, engine)) &&
-      (descriptors[1] = AllocateFastRingDescriptor(ring, HandleInboundCompletion, engine)))
+      (descriptors[1] = AllocateFastRingDescriptor(ring, HandleInboundCompletion, engine)) &&
+      (GetFastRingDescriptorExtension(descriptors[1])))
   {
     engine->ring                 = ring;
     engine->count                = 1;
@@ -1013,12 +1012,12 @@ BIO* CreateFastBIO(struct FastRing* ring, struct FastRingBufferProvider* provide
     engine->flags          &= ~(FASTBIO_FLAG_KTLS_AVAILABLE * !(options & SSL_OP_ENABLE_KTLS));                    // Disable kTLS for this BIO when zero-copy must remain available
 
     io_uring_prep_poll_add(&descriptors[0]->submission, handle, POLLIN | POLLERR | POLLHUP);
-    io_uring_prep_recvmsg_multishot(&descriptors[1]->submission, handle, &descriptors[1]->data.socket.message, 0);
+    io_uring_prep_recvmsg_multishot(&descriptors[1]->submission, handle, &descriptors[1]->extension->socket.message, 0);
 
     PrepareFastRingBuffer(provider, &descriptors[1]->submission);
-    memset(&descriptors[1]->data.socket.message, 0, sizeof(struct msghdr));
-    descriptors[1]->data.socket.message.msg_controllen = CMSG_SPACE(sizeof(uint8_t));
-    descriptors[0]->data.number                        = 0;
+    memset(&descriptors[1]->extension->socket.message, 0, sizeof(struct msghdr));
+    descriptors[1]->extension->socket.message.msg_controllen = CMSG_SPACE(sizeof(uint8_t));
+    descriptors[0]->data.number                              = 0;
 
     if (engine->flags & FASTBIO_FLAG_KTLS_AVAILABLE)
     {
@@ -1,19 +1,191 @@
+#define _GNU_SOURCE
+
 #include "FastBuffer.h"
 
+#include <errno.h>
 #include <malloc.h>
 #include <string.h>
 #include <signal.h>
+#include <unistd.h>
+
+#define likely(condition)     __builtin_expect(!!(condition), 1)
+#define unlikely(condition)   __builtin_expect(!!(condition), 0)
 
 _Static_assert((FAST_BUFFER_ALIGNMENT             % __BIGGEST_ALIGNMENT__) == 0, "FAST_BUFFER_ALIGNMENT must be aligned to __BIGGEST_ALIGNMENT__");
 _Static_assert((offsetof(struct FastBuffer, data) % __BIGGEST_ALIGNMENT__) == 0, "FastBuffer.data must be aligned to __BIGGEST_ALIGNMENT__");
+_Static_assert(FAST_BUFFER_CACHE_CLASSES <= FAST_BUFFER_CLASS_COUNT, "FAST_BUFFER_CACHE_CLASSES must not exceed FAST_BUFFER_CLASS_COUNT");
+_Static_assert(((1 << FAST_BUFFER_CLASS_SHIFT) % FAST_BUFFER_ALIGNMENT) == 0, "FAST_BUFFER_CLASS_SHIFT must keep classes aligned to FAST_BUFFER_ALIGNMENT");
+
+static inline uint32_t GetFastBufferClass(size_t length)
+{
+  uint32_t number;
+  uint32_t shift;
+
+  // Classes are sizes of the whole allocation (with header), the same as chunks of registered buffer arena:
+  // 4 steps of 1 << FAST_BUFFER_CLASS_SHIFT, then 4 classes per power of two
+
+  if (length <= (4ULL << FAST_BUFFER_CLASS_SHIFT))
+  {
+    //
+    return (length - (length != 0)) >> FAST_BUFFER_CLASS_SHIFT;
+  }
+
+  shift  = 61 - __builtin_clzll(length - 1);
+  number = ((shift - FAST_BUFFER_CLASS_SHIFT) << 2) + ((length - 1) >> shift);
+  return (number < FAST_BUFFER_CLASS_COUNT) ? number : FAST_BUFFER_CLASS_COUNT;
+}
+
+static inline size_t GetFastBufferClassSize(uint32_t number)
+{
+  return (number < 4) ?
+    ((size_t)(number + 1) << FAST_BUFFER_CLASS_SHIFT) :
+    ((size_t)((number & 3) + 5) << (FAST_BUFFER_CLASS_SHIFT + (number >> 2) - 1));
+}
+
+static uint32_t PopFastBufferList(struct FastBufferPool* pool, uint32_t number, struct FastBuffer** list, uint32_t count)
+{
+  ATOMIC(struct FastBuffer*)* heap;
+  struct FastBuffer* buffer;
+  void* pointer;
+  uint32_t length;
+
+  heap = pool->heaps + number;
+
+  if (atomic_load_explicit(heap, memory_order_relaxed) == NULL)
+  {
+    // Don't touch the lock for an empty class
+    return 0;
+  }
+
+  // Released buffers can be freed by their popper, so poppers are serialized to never read next of a freed buffer
+
+  while (atomic_exchange_explicit(&pool->lock, 1, memory_order_acquire))
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+  }
+
+  for (length = 0; length < count; ++ length)
+  {
+    do pointer = atomic_load_explicit(heap, memory_order_acquire);
+    while ((buffer = REMOVE_ABA_TAG(struct FastBuffer, pointer, FAST_BUFFER_ALIGNMENT)) &&
+           (!atomic_compare_exchange_weak_explicit(heap, &pointer, buffer->next, memory_order_acquire, memory_order_relaxed)));
+
+    if (buffer == NULL)
+    {
+      //
+      break;
+    }
+
+    list[length] = buffer;
+  }
+
+  atomic_store_explicit(&pool->lock, 0, memory_order_release);
+
+  return length;
+}
+
+static void PushFastBufferList(struct FastBufferPool* pool, uint32_t number, struct FastBuffer** list, uint32_t count)
+{
+  ATOMIC(struct FastBuffer*)* heap;
+  struct FastBuffer* last;
+  uint32_t tag;
+
+  // Tags have been already increased on release, link the list and publish it by a single CAS
+
+  heap = pool->heaps + number;
+  last = list[-- count];
+
+  while (count > 0)
+  {
+    tag                   = atomic_load_explicit(&list[count]->tag, memory_order_relaxed);
+    list[count - 1]->next = ADD_ABA_TAG(list[count], tag, FAST_BUFFER_ALIGNMENT);
+    count --;
+  }
+
+  tag = atomic_load_explicit(&list[0]->tag, memory_order_relaxed);
+
+  do last->next = atomic_load_explicit(heap, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(heap, &last->next, ADD_ABA_TAG(list[0], tag, FAST_BUFFER_ALIGNMENT), memory_order_release, memory_order_relaxed));
+}
+
+static void FreeFastBuffer(struct FastBufferPool* pool, struct FastBuffer* buffer)
+{
+  atomic_fetch_sub_explicit(&pool->statistics.size, buffer->size + sizeof(struct FastBuffer), memory_order_relaxed);
+  atomic_fetch_sub_explicit(&pool->statistics.count, 1, memory_order_relaxed);
+
+  if (buffer->origin == FAST_BUFFER_ORIGIN_ARENA)
+  {
+    // Chunk of the registered buffer arena, its region stays registered
+    ReleaseFastRingRegisteredBuffer(pool->ring, buffer, buffer->size + sizeof(struct FastBuffer), buffer->index);
+    return;
+  }
+
+  UpdateFastRingRegisteredBuffer(pool->ring, buffer->index, NULL, 0);
+  free(buffer);
+}
+
+static void FlushFastBufferCache(struct FastRingCache* header)
+{
+  struct FastBufferCache* cache;
+  uint32_t number;
+
+  cache = (struct FastBufferCache*)header;
+
+  for (number = 0; number < FAST_BUFFER_CACHE_CLASSES; ++ number)
+  {
+    if (cache->counts[number] > 0)
+    {
+      // Thread is exiting, give cached buffers back to the shared stacks
+      PushFastBufferList((struct FastBufferPool*)header->owner, number, cache->stacks[number], cache->counts[number]);
+    }
+
+    cache->counts[number] = 0;
+  }
+}
+
+static void DrainFastBufferCache(struct FastRingCache* header)
+{
+  struct FastBufferCache* cache;
+  uint32_t number;
+
+  cache = (struct FastBufferCache*)header;
+
+  for (number = 0; number < FAST_BUFFER_CACHE_CLASSES; ++ number)
+  {
+    while (cache->counts[number] > 0)
+    {
+      cache->counts[number] --;
+      FreeFastBuffer((struct FastBufferPool*)header->owner, cache->stacks[number][cache->counts[number]]);
+    }
+  }
+}
+
+static inline __attribute__((always_inline)) struct FastBufferCache* GetFastBufferCache(struct FastBufferPool* pool)
+{
+  // Magazines share per-thread map and thread exit handling with descriptor caches of the ring
+  return (struct FastBufferCache*)GetFastRingCache(&pool->caches, sizeof(struct FastBufferCache), FlushFastBufferCache, pool);
+}
 
 struct FastBufferPool* CreateFastBufferPool(struct FastRing* ring)
+{
+  return CreateFastBufferPoolEx(ring, 0);
+}
+
+struct FastBufferPool* CreateFastBufferPoolEx(struct FastRing* ring, uint32_t flags)
 {
   struct FastBufferPool* pool;
 
   pool        = (struct FastBufferPool*)calloc(1, sizeof(struct FastBufferPool));
   pool->ring  = ring;
+  pool->flags = flags * (ring != NULL);
 
+  InitializeFastRingCacheList(&pool->caches);
   atomic_store_explicit(&pool->count, 1, memory_order_relaxed);
 
   return pool;
@@ -23,27 +195,148 @@ void ReleaseFastBufferPool(struct FastBufferPool* pool)
 {
   struct FastBuffer* buffer;
   struct FastBuffer* heap;
+  uint32_t number;
 
   if ((pool != NULL) &&
       (atomic_fetch_sub_explicit(&pool->count, 1, memory_order_release) == 1))
   {
     atomic_thread_fence(memory_order_acquire);
 
-    heap = atomic_load_explicit(&pool->heap, memory_order_acquire);
-    heap = REMOVE_ABA_TAG(struct FastBuffer, heap, FAST_BUFFER_ALIGNMENT);
+    // There are no allocated buffers, so caches of all threads can be drained from here,
+    // caches of live threads are detached and freed by their threads
+    ReleaseFastRingCacheList(&pool->caches, DrainFastBufferCache);
 
-    while (buffer = heap)
+    for (number = 0; number <= FAST_BUFFER_CLASS_COUNT; ++ number)
     {
-      heap = atomic_load_explicit(&buffer->next, memory_order_relaxed);
+      heap = atomic_load_explicit(pool->heaps + number, memory_order_acquire);
       heap = REMOVE_ABA_TAG(struct FastBuffer, heap, FAST_BUFFER_ALIGNMENT);
-      UpdateFastRingRegisteredBuffer(pool->ring, buffer->index, NULL, 0);
-      free(buffer);
+
+      while (buffer = heap)
+      {
+        heap = atomic_load_explicit(&buffer->next, memory_order_relaxed);
+        heap = REMOVE_ABA_TAG(struct FastBuffer, heap, FAST_BUFFER_ALIGNMENT);
+        FreeFastBuffer(pool, buffer);
+      }
     }
 
     free(pool);
   }
 }
 
+void SetFastBufferPoolLimits(struct FastBufferPool* pool, uint64_t low, uint64_t high, uint64_t limit)
+{
+  if (pool != NULL)
+  {
+    pool->low   = low;
+    pool->high  = high;
+    pool->limit = limit;
+  }
+}
+
+static inline __attribute__((always_inline)) uint64_t GetFastBufferPoolIdleSize(struct FastBufferPool* pool)
+{
+  uint64_t size;
+  uint64_t used;
+
+  // Counters are updated separately, a racing allocation can be seen in used but not yet in size
+  used = atomic_load_explicit(&pool->statistics.used, memory_order_relaxed);
+  size = atomic_load_explicit(&pool->statistics.size, memory_order_relaxed);
+
+  return (size > used) ? (size - used) : 0;
+}
+
+static void ReclaimFastBuffer(struct FastBufferPool* pool, struct FastBuffer* buffer)
+{
+  size_t length;
+
+  length = buffer->size + sizeof(struct FastBuffer);
+
+  if (buffer->origin != FAST_BUFFER_ORIGIN_ARENA)
+  {
+    // Arena chunks return to the ring for other pools, but regions stay mapped, so they don't count as memory given back
+    atomic_fetch_add_explicit(&pool->statistics.reclaimed, length, memory_order_relaxed);
+  }
+
+  FreeFastBuffer(pool, buffer);
+}
+
+void ReclaimFastBufferPool(struct FastBufferPool* pool)
+{
+  struct FastBufferCache* cache;
+  struct FastBuffer* buffer;
+  uint32_t number;
+
+  if (unlikely(pool == NULL))
+  {
+    //
+    return;
+  }
+
+  // Watermarks apply to free bytes only, allocated buffers cannot be reclaimed anyway
+  // Magazine of the calling thread first (ring thread keeps buffers released by completions there),
+  // then shared stacks from larger classes, magazines of other threads are bounded and left to their owners
+
+  if ((GetFastBufferPoolIdleSize(pool) > pool->low) &&
+      (cache = GetFastBufferCache(pool)))
+  {
+    for (number = FAST_BUFFER_CACHE_CLASSES; number > 0; -- number)
+    {
+      while ((cache->counts[number - 1] > 0) &&
+             (GetFastBufferPoolIdleSize(pool) > pool->low))
+      {
+        cache->counts[number - 1] --;
+        buffer = cache->stacks[number - 1][cache->counts[number - 1]];
+        ReclaimFastBuffer(pool, buffer);
+      }
+    }
+  }
+
+  for (number = FAST_BUFFER_CLASS_COUNT + 1; number > 0; -- number)
+  {
+    while ((GetFastBufferPoolIdleSize(pool) > pool->low) &&
+           (PopFastBufferList(pool, number - 1, &buffer, 1) != 0))
+    {
+      // Heap buffers are unregistered and freed, arena chunks return to the ring for other pools
+      ReclaimFastBuffer(pool, buffer);
+    }
+  }
+}
+
+static void HandleReclaimFlush(void* closure, int reason)
+{
+  struct FastBufferPool* pool;
+
+  pool = (struct FastBufferPool*)closure;
+
+  if (reason != RING_REASON_RELEASED)
+  {
+    //
+    ReclaimFastBufferPool(pool);
+  }
+
+  atomic_store_explicit(&pool->reclaiming, 0, memory_order_release);
+  ReleaseFastBufferPool(pool);
+}
+
+int GetFastBufferPoolStatistics(struct FastBufferPool* pool, struct FastBufferPoolStatistics* snapshot)
+{
+  if (unlikely((pool     == NULL) ||
+               (snapshot == NULL)))
+  {
+    //
+    return -EINVAL;
+  }
+
+  atomic_store_explicit(&snapshot->size,      atomic_load_explicit(&pool->statistics.size,      memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->used,      atomic_load_explicit(&pool->statistics.used,      memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->peak,      atomic_load_explicit(&pool->statistics.peak,      memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->count,     atomic_load_explicit(&pool->statistics.count,     memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->failures,  atomic_load_explicit(&pool->statistics.failures,  memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->reclaimed, atomic_load_explicit(&pool->statistics.reclaimed, memory_order_relaxed), memory_order_relaxed);
+
+  return 0;
+}
+
 void TryRegisterFastBuffer(struct FastBuffer* buffer, int option)
 {
   struct FastBufferPool* pool;
@@ -69,30 +362,54 @@ void TryRegisterFastBuffer(struct FastBuffer* buffer, int option)
 
 struct FastBuffer* AllocateFastBuffer(struct FastBufferPool* pool, uint32_t size, int option)
 {
+  int index;
+  int origin;
   uint32_t tag;
-  void* pointer;
+  uint32_t slot;
+  uint32_t limit;
+  uint32_t number;
+  uint64_t total;
+  uint64_t peak;
+  size_t length;
+  struct FastBufferCache* cache;
   struct FastBuffer* buffer;
 
-  tag = 0;
+  tag    = 0;
+  buffer = NULL;
+  index  = INT32_MIN;
+  origin = FAST_BUFFER_ORIGIN_HEAP;
+  length = size + sizeof(struct FastBuffer);
+  number = GetFastBufferClass(length);
+  limit  = number + FAST_BUFFER_CLASS_SEARCH;
+  limit  = (number == FAST_BUFFER_CLASS_COUNT) ? number : ((limit < FAST_BUFFER_CLASS_COUNT) ? limit : (FAST_BUFFER_CLASS_COUNT - 1));
+  length = (number == FAST_BUFFER_CLASS_COUNT) ? length : GetFastBufferClassSize(number);
 
   atomic_fetch_add_explicit(&pool->count, 1, memory_order_relaxed);
 
-  while (atomic_exchange_explicit(&pool->lock, 1, memory_order_acquire))
+  // Best fit: the class of requested size first, then a few larger ones before going to the heap
+  // Cached classes are served from the magazine of the thread, an empty one is refilled by a batch from the shared stack
+
+  if ((number < FAST_BUFFER_CACHE_CLASSES) &&
+      (cache  = GetFastBufferCache(pool)))
   {
-#if defined(__x86_64__) || defined(__i386__)
-    __builtin_ia32_pause();
-#elif defined(__aarch64__) || defined(__arm__)
-    __asm__ __volatile__("yield");
-#else
-    __asm__ __volatile__("" ::: "memory");
-#endif
-  }
+    for (slot = number; (slot <= limit) && (slot < FAST_BUFFER_CACHE_CLASSES); ++ slot)
+    {
+      if ((cache->counts[slot] > 0) ||
+          (cache->counts[slot] = PopFastBufferList(pool, slot, cache->stacks[slot], FAST_BUFFER_CACHE_BATCH)))
+      {
+        cache->counts[slot] --;
+        buffer = cache->stacks[slot][cache->counts[slot]];
+        break;
+      }
+    }
 
-  do pointer = atomic_load_explicit(&pool->heap, memory_order_acquire);
-  while ((buffer = REMOVE_ABA_TAG(struct FastBuffer, pointer, FAST_BUFFER_ALIGNMENT)) &&
-         (!atomic_compare_exchange_weak_explicit(&pool->heap, &pointer, buffer->next, memory_order_acquire, memory_order_relaxed)));
+    number = slot;
+  }
 
-  atomic_store_explicit(&pool->lock, 0, memory_order_release);
+  while ((buffer == NULL) &&
+         (number <= limit) &&
+         (PopFastBufferList(pool, number, &buffer, 1) == 0))
+    number ++;
 
   if (buffer != NULL)
   {
@@ -109,31 +426,64 @@ struct FastBuffer* AllocateFastBuffer(struct FastBufferPool* pool, uint32_t size
       buffer->next   = NULL;
       buffer->state  = FAST_BUFFER_STATE_ALLOCATED;
       atomic_store_explicit(&buffer->count, 1, memory_order_release);
+      atomic_fetch_add_explicit(&pool->statistics.used, buffer->size + sizeof(struct FastBuffer), memory_order_relaxed);
+      TryRegisterFastBuffer(buffer, option);
       return buffer;
     }
 
-    // There is no alligned realloc, so only way is to release and allocate again
-    UpdateFastRingRegisteredBuffer(pool->ring, buffer->index, NULL, 0);
+    // Only the class of larger buffers has no fixed size,
+    // there is no alligned realloc, so only way is to release and allocate again
     tag = buffer->tag;
-    free(buffer);
+    FreeFastBuffer(pool, buffer);
   }
 
-  if (buffer = (struct FastBuffer*)memalign(FAST_BUFFER_ALIGNMENT, size + sizeof(struct FastBuffer)))
+  total = atomic_fetch_add_explicit(&pool->statistics.size, length, memory_order_relaxed) + length;
+
+  if (unlikely((pool->limit != 0) &&
+               (pool->limit <  total)))
+  {
+    // Hard cap: fail fast and let the caller apply backpressure
+    atomic_fetch_add_explicit(&pool->statistics.failures, 1, memory_order_relaxed);
+    goto Failure;
+  }
+
+  if (((option & FAST_BUFFER_REGISTER) ||
+       (pool->flags & FAST_BUFFER_POOL_SLABS)) &&
+      (pool->ring != NULL) &&
+      (buffer = (struct FastBuffer*)AllocateFastRingRegisteredBuffer(pool->ring, length, &index)))
+  {
+    // Sub-range of the region registered once, fixed-buffer offset semantics allow any address within it
+    // Regions are huge pages on the node of the ring thread, so slab pools take them even for unregistered use
+    origin = FAST_BUFFER_ORIGIN_ARENA;
+  }
+
+  if ((origin == FAST_BUFFER_ORIGIN_ARENA) ||
+      (buffer  = (struct FastBuffer*)memalign(FAST_BUFFER_ALIGNMENT, length)))
   {
     buffer->tag    = tag;
     buffer->pool   = pool;
     buffer->next   = NULL;
-    buffer->size   = size;
+    buffer->size   = length - sizeof(struct FastBuffer);
     buffer->length = 0;
-    buffer->status = FAST_BUFFER_STATUS_ADDED;
-    buffer->index  = INT32_MIN;
+    buffer->origin = origin;
+    buffer->status = (origin == FAST_BUFFER_ORIGIN_ARENA) ? FAST_BUFFER_STATUS_UNCHANGED : FAST_BUFFER_STATUS_ADDED;
+    buffer->index  = index;
     buffer->magic  = FAST_BUFFER_MAGIC;
     buffer->state  = FAST_BUFFER_STATE_ALLOCATED;
     atomic_store_explicit(&buffer->count, 1, memory_order_release);
+    atomic_fetch_add_explicit(&pool->statistics.used, length, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->statistics.count, 1, memory_order_relaxed);
     TryRegisterFastBuffer(buffer, option);
+
+    peak = atomic_load_explicit(&pool->statistics.peak, memory_order_relaxed);
+    while ((peak < total) && (!atomic_compare_exchange_weak_explicit(&pool->statistics.peak, &peak, total, memory_order_relaxed, memory_order_relaxed)));
+
     return buffer;
   }
 
+  Failure:
+
+  atomic_fetch_sub_explicit(&pool->statistics.size, length, memory_order_relaxed);
   atomic_fetch_sub_explicit(&pool->count, 1, memory_order_relaxed);
   return NULL;
 }
@@ -146,8 +496,9 @@ struct FastBuffer* HoldFastBuffer(struct FastBuffer* buffer)
 
 void ReleaseFastBuffer(struct FastBuffer* buffer)
 {
-  uint32_t tag;
+  uint32_t number;
   struct FastBufferPool* pool;
+  struct FastBufferCache* cache;
 
   if (buffer != NULL)
   {
@@ -164,11 +515,46 @@ void ReleaseFastBuffer(struct FastBuffer* buffer)
 
       buffer->state = FAST_BUFFER_STATE_FREE;
 
-      pool = buffer->pool;
-      tag  = atomic_fetch_add_explicit(&buffer->tag, 1, memory_order_relaxed) + 1;
-
-      do buffer->next = atomic_load_explicit(&pool->heap, memory_order_relaxed);
-      while (!atomic_compare_exchange_weak_explicit(&pool->heap, &buffer->next, ADD_ABA_TAG(buffer, tag, FAST_BUFFER_ALIGNMENT), memory_order_release, memory_order_relaxed));
+      pool   = buffer->pool;
+      number = GetFastBufferClass(buffer->size + sizeof(struct FastBuffer));
+
+      atomic_fetch_sub_explicit(&pool->statistics.used, buffer->size + sizeof(struct FastBuffer), memory_order_relaxed);
+      atomic_fetch_add_explicit(&buffer->tag, 1, memory_order_relaxed);
+
+      if ((number < FAST_BUFFER_CACHE_CLASSES) &&
+          (cache  = GetFastBufferCache(pool)))
+      {
+        if (unlikely(cache->counts[number] == FAST_BUFFER_CACHE_LENGTH))
+        {
+          // Magazine is full, return the older half to the shared stack
+          PushFastBufferList(pool, number, cache->stacks[number], FAST_BUFFER_CACHE_BATCH);
+          memmove(cache->stacks[number], cache->stacks[number] + FAST_BUFFER_CACHE_BATCH, (FAST_BUFFER_CACHE_LENGTH - FAST_BUFFER_CACHE_BATCH) * sizeof(struct FastBuffer*));
+          cache->counts[number] -= FAST_BUFFER_CACHE_BATCH;
+        }
+
+        cache->stacks[number][cache->counts[number]] = buffer;
+        cache->counts[number] ++;
+      }
+      else
+      {
+        // Larger buffers and buffers released when cache cannot be allocated
+        PushFastBufferList(pool, number, &buffer, 1);
+      }
+
+      if (unlikely((pool->high != 0) &&
+                   (pool->ring != NULL) &&
+                   (GetFastBufferPoolIdleSize(pool) > pool->high) &&
+                   (atomic_exchange_explicit(&pool->reclaiming, 1, memory_order_acquire) == 0)))
+      {
+        // Reclaim runs on the ring thread, the flusher holds a reference to the pool
+        atomic_fetch_add_explicit(&pool->count, 1, memory_order_relaxed);
+
+        if (unlikely(SetFastRingFlushHandler(pool->ring, HandleReclaimFlush, pool) == NULL))
+        {
+          atomic_store_explicit(&pool->reclaiming, 0, memory_order_relaxed);
+          atomic_fetch_sub_explicit(&pool->count, 1, memory_order_relaxed);
+        }
+      }
 
       // Decrease pool reference count and release when required
       ReleaseFastBufferPool(pool);
@@ -185,6 +571,132 @@ void PrepareFastBuffer(struct FastRingDescriptor* descriptor, struct FastBuffer*
   }
 }
 
+struct FastBufferChain* CreateFastBufferChain(uint32_t size)
+{
+  struct FastBufferChain* chain;
+
+  if (unlikely((size == 0) ||
+               (size >  UIO_MAXIOV)))
+  {
+    //
+    return NULL;
+  }
+
+  if (chain = (struct FastBufferChain*)malloc(sizeof(struct FastBufferChain) + size * (sizeof(struct iovec) + sizeof(struct FastBuffer*))))
+  {
+    chain->size    = size;
+    chain->number  = 0;
+    chain->length  = 0;
+    chain->buffers = (struct FastBuffer**)(chain->vectors + size);
+    atomic_store_explicit(&chain->count, 1, memory_order_release);
+  }
+
+  return chain;
+}
+
+struct FastBufferChain* HoldFastBufferChain(struct FastBufferChain* chain)
+{
+  atomic_fetch_add_explicit(&chain->count, 1, memory_order_relaxed);
+  return chain;
+}
+
+void ReleaseFastBufferChain(struct FastBufferChain* chain)
+{
+  uint32_t number;
+
+  if ((chain != NULL) &&
+      (atomic_fetch_sub_explicit(&chain->count, 1, memory_order_release) == 1))
+  {
+    atomic_thread_fence(memory_order_acquire);
+
+    for (number = 0; number < chain->number; ++ number)
+    {
+      //
+      ReleaseFastBuffer(chain->buffers[number]);
+    }
+
+    free(chain);
+  }
+}
+
+int AppendFastBufferChain(struct FastBufferChain* chain, struct FastBuffer* buffer, uint32_t offset, uint32_t length)
+{
+  struct iovec* vector;
+
+  if (unlikely((chain  == NULL) ||
+               (buffer == NULL) ||
+               (offset >  buffer->size) ||
+               (length >  (buffer->size - offset))))
+  {
+    //
+    return -EINVAL;
+  }
+
+  if (length == 0)
+  {
+    //
+    return 0;
+  }
+
+  vector = chain->vectors + chain->number - 1;
+
+  if ((chain->number > 0) &&
+      (chain->buffers[chain->number - 1] == buffer) &&
+      ((uint8_t*)vector->iov_base + vector->iov_len == buffer->data + offset))
+  {
+    // Continuation of the last slice, the reference is already held
+    vector->iov_len += length;
+    chain->length   += length;
+    return 0;
+  }
+
+  if (unlikely(chain->number == chain->size))
+  {
+    //
+    return -ENOSPC;
+  }
+
+  vector ++;
+  vector->iov_base = buffer->data + offset;
+  vector->iov_len  = length;
+
+  chain->buffers[chain->number] = HoldFastBuffer(buffer);
+  chain->number ++;
+  chain->length += length;
+
+  return 0;
+}
+
+struct FastBuffer* TakeProvidedFastBuffer(struct FastRingBufferProvider* provider, struct FastBufferPool* pool, struct io_uring_cqe* completion)
+{
+  struct FastBuffer* buffer;
+  uint8_t* data;
+
+  if ((completion->res < 0) ||
+      ((data = GetFastRingBuffer(provider, completion)) == NULL))
+  {
+    //
+    return NULL;
+  }
+
+  if (provider->flags & RING_BUFFER_FLAG_INCREMENTAL)
+  {
+    // Slice of a shared buffer: the caller gets a copy of exact size and the buffer stays with the provider
+    if (buffer = AllocateFastBuffer(pool, completion->res, 0))
+    {
+      //
+      memcpy(buffer->data, data, completion->res);
+    }
+
+    AdvanceFastRingBuffer(provider, completion, NULL, NULL);
+    return buffer;
+  }
+
+  // Whole buffer is passed to the caller and replaced in the provider
+  AdvanceFastRingBuffer(provider, completion, AllocateRingFastBuffer, pool);
+  return FAST_BUFFER(data);
+}
+
 void* AllocateRingFastBuffer(size_t size, void* closure)
 {
   struct FastBuffer* buffer;
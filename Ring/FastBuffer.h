@@ -13,6 +13,8 @@ extern "C"
 
 #define FAST_BUFFER_REGISTER          (1 << 0)
 
+#define FAST_BUFFER_POOL_SLABS        (1 << 0)
+
 #define FAST_BUFFER_STATE_FREE        0
 #define FAST_BUFFER_STATE_ALLOCATED   1
 
@@ -20,10 +22,37 @@ extern "C"
 #define FAST_BUFFER_STATUS_UPDATED    1
 #define FAST_BUFFER_STATUS_UNCHANGED  2
 
+#define FAST_BUFFER_ORIGIN_HEAP       0
+#define FAST_BUFFER_ORIGIN_ARENA      1
+
 #define FAST_BUFFER_MAGIC             0xfa37baffea00a61cULL
 
+#ifndef FAST_BUFFER_CLASS_SHIFT
+#define FAST_BUFFER_CLASS_SHIFT       6
+#endif
+
+#ifndef FAST_BUFFER_CLASS_COUNT
+#define FAST_BUFFER_CLASS_COUNT       56
+#endif
+
+#ifndef FAST_BUFFER_CLASS_SEARCH
+#define FAST_BUFFER_CLASS_SEARCH      8
+#endif
+
+#ifndef FAST_BUFFER_CACHE_LENGTH
+#define FAST_BUFFER_CACHE_LENGTH      16
+#endif
+
+#ifndef FAST_BUFFER_CACHE_CLASSES
+#define FAST_BUFFER_CACHE_CLASSES     36
+#endif
+
+#define FAST_BUFFER_CACHE_BATCH       (FAST_BUFFER_CACHE_LENGTH / 2)
+
 struct FastBuffer;
 struct FastBufferStack;
+struct FastBufferCache;
+struct FastBufferChain;
 struct FastBufferPool;
 
 struct FastBuffer
@@ -31,7 +60,7 @@ struct FastBuffer
   int state;                        // FAST_BUFFER_STATE_*
   int index;                        // Index of registration or INT32_MIN (not set) or error code
   int status;                       // FAST_BUFFER_STATUS_*
-  int reserved;                     //
+  int origin;                       // FAST_BUFFER_ORIGIN_*
   uint32_t size;                    // Size of available space for data
   uint32_t length;                  // Length of available data (optional)
   struct FastBufferPool* pool;      //
@@ -43,16 +72,54 @@ struct FastBuffer
   uint8_t data[0];                  //
 };
 
+struct FastBufferChain
+{
+  ATOMIC(uint32_t) count;           // Reference count
+  uint32_t size;                    // Capacity in slices
+  uint32_t number;                  // Count of slices
+  size_t length;                    // Length of data of all slices
+  struct FastBuffer** buffers;      // Buffers of slices (each slice holds a reference)
+  struct iovec vectors[0];          // Slices suitable for sendmsg() / writev()
+};
+
+struct FastBufferPoolStatistics
+{
+  ATOMIC(uint64_t) size;            // Bytes held by the pool (allocated and free buffers with headers)
+  ATOMIC(uint64_t) used;            // Bytes of allocated buffers
+  ATOMIC(uint64_t) peak;            // Maximal size
+  ATOMIC(uint64_t) count;           // Count of buffers held by the pool
+  ATOMIC(uint64_t) failures;        // Allocations refused by the hard cap
+  ATOMIC(uint64_t) reclaimed;       // Bytes of heap buffers given back by reclaim (arena chunks are not counted)
+};
+
+struct FastBufferCache
+{
+  struct FastRingCache header;      // Owner is the pool
+  uint32_t counts[FAST_BUFFER_CACHE_CLASSES];
+  struct FastBuffer* stacks[FAST_BUFFER_CACHE_CLASSES][FAST_BUFFER_CACHE_LENGTH];
+};
+
 struct FastBufferPool
 {
   struct FastRing* ring;            //
-  ATOMIC(uint32_t) lock;            // Allocation pop spinlock
+  uint32_t flags;                   // FAST_BUFFER_POOL_*
+  ATOMIC(uint32_t) lock;            // Batch pop spinlock of shared stacks
   ATOMIC(uint32_t) count;           // Reference count
-  ATOMIC(struct FastBuffer*) heap;  // Stack of available buffers
+  struct FastRingCacheList caches;  // Per-thread caches in front of shared stacks
+  uint64_t low;                     // Free bytes reclaim stops at
+  uint64_t high;                    // Free bytes release schedules reclaim at (0 - never)
+  uint64_t limit;                   // Hard cap of size for new buffers (0 - unlimited)
+  ATOMIC(uint32_t) reclaiming;      // Reclaim is scheduled on the ring thread
+  struct FastBufferPoolStatistics statistics;  //
+  ATOMIC(struct FastBuffer*) heaps[FAST_BUFFER_CLASS_COUNT + 1];  // Stacks of available buffers per size class (the last one is for larger buffers)
 };
 
 struct FastBufferPool* CreateFastBufferPool(struct FastRing* ring);
+struct FastBufferPool* CreateFastBufferPoolEx(struct FastRing* ring, uint32_t flags);
 void ReleaseFastBufferPool(struct FastBufferPool* pool);
+void SetFastBufferPoolLimits(struct FastBufferPool* pool, uint64_t low, uint64_t high, uint64_t limit);
+void ReclaimFastBufferPool(struct FastBufferPool* pool);
+int GetFastBufferPoolStatistics(struct FastBufferPool* pool, struct FastBufferPoolStatistics* snapshot);
 void TryRegisterFastBuffer(struct FastBuffer* buffer, int option);
 struct FastBuffer* AllocateFastBuffer(struct FastBufferPool* pool, uint32_t size, int option);
 struct FastBuffer* HoldFastBuffer(struct FastBuffer* buffer);
@@ -60,6 +127,15 @@ void ReleaseFastBuffer(struct FastBuffer* buffer);
 
 void PrepareFastBuffer(struct FastRingDescriptor* descriptor, struct FastBuffer* buffer);
 
+// Chain: refcounted list of slices (offset and length within data of FastBuffers) to pass data through without copying
+
+struct FastBufferChain* CreateFastBufferChain(uint32_t size);
+struct FastBufferChain* HoldFastBufferChain(struct FastBufferChain* chain);
+void ReleaseFastBufferChain(struct FastBufferChain* chain);
+int AppendFastBufferChain(struct FastBufferChain* chain, struct FastBuffer* buffer, uint32_t offset, uint32_t length);
+
+struct FastBuffer* TakeProvidedFastBuffer(struct FastRingBufferProvider* provider, struct FastBufferPool* pool, struct io_uring_cqe* completion);
+
 void* AllocateRingFastBuffer(size_t size, void* closure);
 void ReleaseRingFastBuffer(void* buffer);
 
@@ -5,8 +5,11 @@
 
 #include <malloc.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
 #include <sys/resource.h>
+#include <linux/mempolicy.h>
 
 #define likely(condition)     __builtin_expect(!!(condition), 1)
 #define unlikely(condition)   __builtin_expect(!!(condition), 0)
@@ -21,8 +24,29 @@
 #define FILE_REGISTRATION_RATIO  2
 
 #define QUEUE_DEFAULT_LENGTH     256
+#define CACHE_MAP_LENGTH         8
 #define FLUSH_LIST_INCREASE      64
 #define FILE_LIST_INCREASE       1024
+#define FILE_FILTER_LEVELS       3
+#define FILE_UPDATE_BATCH_LENGTH 64
+#define REGION_NODE_MASK_LENGTH  16
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT           26
+#endif
+
+#if RING_BUFFER_REGION_SHIFT >= 30
+#define REGION_HUGE_PAGE_FLAGS   (MAP_HUGETLB | (30 << MAP_HUGE_SHIFT))
+#else
+#define REGION_HUGE_PAGE_FLAGS   (MAP_HUGETLB | (21 << MAP_HUGE_SHIFT))
+#endif
+
+_Static_assert(sizeof(struct FastRingDescriptor) <= RING_DESC_ALIGNMENT, "FastRingDescriptor must fit in RING_DESC_ALIGNMENT");
+_Static_assert(offsetof(struct FastRingDescriptor, submission) == 64, "FastRingDescriptor's header must fit in one cache line");
+_Static_assert(offsetof(struct FastRingDescriptor, slab) >= 192, "FastRingDescriptor's slab, extension and data must share the last cache line");
+_Static_assert((RING_DESC_SLAB_SIZE % RING_DESC_ALIGNMENT) == 0, "RING_DESC_SLAB_SIZE must be multiple of RING_DESC_ALIGNMENT");
+_Static_assert((RING_BUFFER_REGION_SHIFT >= 21) && (RING_BUFFER_REGION_SHIFT <= 30), "RING_BUFFER_REGION_SIZE must be between huge page and maximal size of fixed buffer");
+_Static_assert((FILE_MAXIMUM_COUNT / 2) <= (1U << (6 * FILE_FILTER_LEVELS + 1)), "FILE_FILTER_LEVELS must keep top level of registered file filter small");
 
 #ifndef USE_RING_LEVEL_TRIGGERING
 #define RING_POLL_FLAGS(flags)  ((~flags >> RING_POLL_FLAGS_SHIFT) & (IORING_POLL_ADD_MULTI))
@@ -30,12 +54,44 @@
 #define RING_POLL_FLAGS(flags)  ((~flags >> RING_POLL_FLAGS_SHIFT) & (IORING_POLL_ADD_MULTI | IORING_POLL_ADD_LEVEL))
 #endif
 
+// Older UAPI headers name the field pad (flags since 6.8), it follows bgid in both cases
+#define RING_BUFFER_REGISTRATION_FLAGS(registration)  (((__u16*)&(registration).bgid)[1])
+
 #ifndef IORING_ENTER_NO_IOWAIT
 #define io_uring_set_iowait(ring, value)
 #endif
 
+#ifdef RING_FEATURE_STATISTICS
+// ADD is for counters shared between threads, PUT is for counters with single writer (no locked instructions)
+#define RING_STATISTICS_ADD(counter, value)  atomic_fetch_add_explicit(&(counter), (value), memory_order_relaxed)
+#define RING_STATISTICS_PUT(counter, value)  atomic_store_explicit(&(counter), atomic_load_explicit(&(counter), memory_order_relaxed) + (value), memory_order_relaxed)
+#else
+#define RING_STATISTICS_ADD(counter, value)
+#define RING_STATISTICS_PUT(counter, value)
+#endif
+
 // Supplementary
 
+static ATOMIC(uint64_t) serial = 0;
+
+struct RingCacheEntry
+{
+  uint64_t serial;                               // Serial of the list (0 - empty)
+  struct FastRingCache* cache;                   //
+};
+
+struct RingCacheMap
+{
+  uint32_t mask;                                 // Length of entries - 1
+  uint32_t count;                                // Count of used entries
+  struct RingCacheEntry entries[0];              // Open addressing by serial, linear probing
+};
+
+// Caches of the thread (descriptor caches and buffer magazines), the key flushes them on thread exit
+static __thread struct RingCacheMap* caches = NULL;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;
+
 static __attribute__((constructor)) void Initialize()
 {
 #ifdef __aarch64__
@@ -43,22 +99,120 @@ static __attribute__((constructor)) void Initialize()
 #endif
 }
 
-static void* ExpandRingFileList(struct FastRingFileList* list, int handle)
+static inline __attribute__((always_inline)) struct FastRingFileEntry* GetRingFileEntry(struct FastRingFileList* list, int handle)
 {
-  struct FastRingFileEntry* entries;
+  struct FastRingFileTable* table;
+  struct FastRingFileEntry* page;
+  uint32_t number;
+
+  // Lock-free lookup: pages are never moved and replaced tables are kept until release,
+  // so a reader holding an outdated table still gets the same entry
+
+  table  = atomic_load_explicit(&list->table, memory_order_acquire);
+  number = (uint32_t)handle / FILE_LIST_INCREASE;
+
+  if (likely((table  != NULL)          &&
+             (number <  table->length) &&
+             (page = atomic_load_explicit(table->pages + number, memory_order_acquire))))
+  {
+    //
+    return page + (uint32_t)handle % FILE_LIST_INCREASE;
+  }
+
+  return NULL;
+}
+
+static struct FastRingFileEntry* ExpandRingFileList(struct FastRingFileList* list, int handle)
+{
+  struct FastRingFileTable* current;
+  struct FastRingFileTable* table;
+  struct FastRingFileEntry* page;
+  uint32_t number;
   uint32_t length;
 
-  length  = ((handle + 1) | (FILE_LIST_INCREASE - 1)) + 1;
-  entries = (struct FastRingFileEntry*)realloc(list->entries, length * sizeof(struct FastRingFileEntry));
+  // Has to be called under the lock of list, growth is RCU-style: the table of pages is copied
+  // and published as a whole, entries themselves stay in place and are updated lock-free
+
+  current = atomic_load_explicit(&list->table, memory_order_relaxed);
+  number  = (uint32_t)handle / FILE_LIST_INCREASE;
+  table   = current;
+
+  if ((current == NULL) ||
+      (number  >= current->length))
+  {
+    length  = (current != NULL) ? current->length * 2 : 1;
+    length += (length <= number) * (number + 1 - length);
+    table   = (struct FastRingFileTable*)calloc(1, sizeof(struct FastRingFileTable) + length * sizeof(struct FastRingFileEntry*));
+
+    if (unlikely(table == NULL))
+    {
+      //
+      return NULL;
+    }
+
+    if (current != NULL)
+    {
+      // Pages are installed only under the lock, so the copy can't miss any of them
+      memcpy(table->pages, current->pages, current->length * sizeof(struct FastRingFileEntry*));
+    }
+
+    table->length   = length;
+    table->previous = current;
+
+    atomic_store_explicit(&list->table, table, memory_order_release);
+  }
+
+  if ((page = atomic_load_explicit(table->pages + number, memory_order_relaxed)) == NULL)
+  {
+    page = (struct FastRingFileEntry*)calloc(FILE_LIST_INCREASE, sizeof(struct FastRingFileEntry));
+
+    if (unlikely(page == NULL))
+    {
+      //
+      return NULL;
+    }
+
+    atomic_store_explicit(table->pages + number, page, memory_order_release);
+  }
+
+  return page + (uint32_t)handle % FILE_LIST_INCREASE;
+}
+
+static void ReleaseRingFileList(struct FastRingFileList* list)
+{
+  struct FastRingFileTable* table;
+  struct FastRingFileTable* next;
+  uint32_t number;
+
+  if (table = atomic_load_explicit(&list->table, memory_order_acquire))
+  {
+    for (number = 0; number < table->length; ++ number)
+    {
+      //
+      free(atomic_load_explicit(table->pages + number, memory_order_relaxed));
+    }
+  }
 
-  if (likely(entries != NULL))
+  while (table != NULL)
   {
-    memset(entries + list->length, 0, (length - list->length) * sizeof(struct FastRingFileEntry));
-    list->length  = length;
-    list->entries = entries;
+    next = table->previous;
+    free(table);
+    table = next;
   }
 
-  return entries;
+  free(list->filters);
+}
+
+static void ReleaseRingBufferRegions(struct FastRingBufferList* list)
+{
+  struct FastRingBufferRegion* region;
+
+  while (region = list->regions)
+  {
+    list->regions = region->next;
+    munmap(region->address, RING_BUFFER_REGION_SIZE);
+    free(region);
+  }
 }
 
 // FastRing
@@ -103,213 +257,923 @@ static inline __attribute__((always_inline)) struct FastRingFlusher* PopRingFlus
   return flusher;
 }
 
-static inline __attribute__((always_inline)) void ReleaseRingDescriptorHeap(struct FastRingDescriptorSet* set)
+static uint32_t PopRingDescriptorList(struct FastRingDescriptorSet* set, struct FastRingDescriptor** list, uint32_t count)
 {
-  struct FastRingDescriptor* current;
-  struct FastRingDescriptor* next;
+  void* pointer;
+  void* next;
+  uint32_t number;
+  struct FastRingDescriptor* descriptor;
 
-  next = atomic_exchange_explicit(&set->heap, NULL, memory_order_acquire);
+  // Since every push changes the tag of descriptor, an unchanged top of stack guarantees unchanged chain below it
 
-  while (current = next)
+  do
   {
-    next = current->heap;
-    if ((current->state    != RING_DESC_STATE_FREE) &&
-        (current->function != NULL))
+    number  = 0;
+    pointer = atomic_load_explicit(&set->available, memory_order_acquire);
+    next    = pointer;
+
+    while ((number < count) &&
+           (descriptor = REMOVE_ABA_TAG(struct FastRingDescriptor, next, RING_DESC_ALIGNMENT)))
     {
-      // Before freeing a descriptor call related handler to complete all incomplete submissions
-      current->function(current, NULL, RING_REASON_RELEASED);
+      list[number ++] = descriptor;
+      next            = atomic_load_explicit(&descriptor->next, memory_order_relaxed);
     }
-    free(current);
   }
+  while ((number > 0) &&
+         (!atomic_compare_exchange_weak_explicit(&set->available, &pointer, next, memory_order_acquire, memory_order_relaxed)));
+
+  RING_STATISTICS_ADD(set->allocated, number);
+  return number;
 }
 
-static inline __attribute__((always_inline)) struct FastRingDescriptor* AllocateRingDescriptor(struct FastRingDescriptorSet* set)
+static void PushRingDescriptorList(struct FastRingDescriptorSet* set, struct FastRingDescriptor** list, uint32_t count)
 {
-  void* pointer;
-  struct FastRingDescriptor* descriptor;
+  struct FastRingDescriptor* last;
+  uint32_t tag;
+
+  // Change the tag of every descriptor, release alone is not enough: magazines push back refilled descriptors
+  // that have never been allocated, so a former top could return with the same tag and a different chain below it
 
-  do pointer = atomic_load_explicit(&set->available, memory_order_acquire);
-  while ((descriptor = REMOVE_ABA_TAG(struct FastRingDescriptor, pointer, RING_DESC_ALIGNMENT)) &&
-         (!atomic_compare_exchange_weak_explicit(&set->available, &pointer, descriptor->next, memory_order_acquire, memory_order_relaxed)));
+  last = list[-- count];
 
-  if (unlikely(((descriptor == NULL) ||
-                (descriptor->state != RING_DESC_STATE_FREE)) &&
-               (descriptor = (struct FastRingDescriptor*)memalign(RING_DESC_ALIGNMENT, sizeof(struct FastRingDescriptor)))))
+  while (count > 0)
   {
-    memset(descriptor, 0, sizeof(struct FastRingDescriptor));
-    do descriptor->heap = atomic_load_explicit(&set->heap, memory_order_relaxed);
-    while (!atomic_compare_exchange_weak_explicit(&set->heap, &descriptor->heap, descriptor, memory_order_release, memory_order_relaxed));
+    tag                   = atomic_fetch_add_explicit(&list[count]->tag, 1, memory_order_relaxed) + 1;
+    list[count - 1]->next = ADD_ABA_TAG(list[count], tag, RING_DESC_ALIGNMENT);
+    count --;
   }
 
-  return descriptor;
+  tag = atomic_fetch_add_explicit(&list[0]->tag, 1, memory_order_relaxed) + 1;
+
+  do last->next = atomic_load_explicit(&set->available, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&set->available, &last->next, ADD_ABA_TAG(list[0], tag, RING_DESC_ALIGNMENT), memory_order_release, memory_order_relaxed));
 }
 
-static inline __attribute__((always_inline)) void ReleaseRingDescriptor(struct FastRingDescriptorSet* set, struct FastRingDescriptor* descriptor)
+static void ReleaseRingCacheMap(void* pointer)
 {
-  uint32_t tag;
+  struct RingCacheMap* map;
+  struct FastRingCache* cache;
+  uint32_t state;
+  uint32_t index;
+
+  map = (struct RingCacheMap*)pointer;
+
+  for (index = 0; index <= map->mask; index ++)
+  {
+    if (cache = map->entries[index].cache)
+    {
+      state = RING_CACHE_ACTIVE;
+
+      if (atomic_compare_exchange_strong_explicit(&cache->state, &state, RING_CACHE_FLUSHING, memory_order_acquire, memory_order_acquire))
+      {
+        // Thread is exiting, give cached objects back while the owner waits for RING_CACHE_FLUSHING to finish
+        cache->function(cache);
+        atomic_store_explicit(&cache->state, RING_CACHE_ABANDONED, memory_order_release);
+        continue;
+      }
+
+      while (state == RING_CACHE_FLUSHING)
+      {
+        // Owner is draining the cache on release, it is detached when done
+        sched_yield();
+        state = atomic_load_explicit(&cache->state, memory_order_acquire);
+      }
 
-  tag = atomic_fetch_add_explicit(&descriptor->tag, 1, memory_order_relaxed) + 1;
+      // Owner is already released, the cache belongs to the thread
+      free(cache);
+    }
+  }
 
-  do descriptor->next = atomic_load_explicit(&set->available, memory_order_relaxed);
-  while (!atomic_compare_exchange_weak_explicit(&set->available, &descriptor->next, ADD_ABA_TAG(descriptor, tag, RING_DESC_ALIGNMENT), memory_order_release, memory_order_relaxed));
+  // Later destructors may still release objects, they will start a new map
+  caches = NULL;
+  free(map);
 }
 
-static inline __attribute__((always_inline)) void SubmitRingDescriptorRange(struct FastRingDescriptorSet* set, struct FastRingDescriptor* first, struct FastRingDescriptor* last)
+static void CreateRingCacheKey()
 {
-  struct FastRingDescriptor* descriptor;
-
-  atomic_store_explicit(&last->next, NULL, memory_order_relaxed);
-  descriptor = atomic_exchange_explicit(&set->pending, last, memory_order_relaxed);
-  atomic_store_explicit(&descriptor->next, first, memory_order_release);
+  //
+  pthread_key_create(&key, ReleaseRingCacheMap);
 }
 
-static inline __attribute__((always_inline)) void PrepareRingDescriptor(struct FastRingDescriptor* descriptor, int option)
+static int InsertRingCache(uint64_t number, struct FastRingCache* cache)
 {
-  uint32_t tag;
+  struct RingCacheMap* other;
+  struct FastRingCache* current;
+  uint32_t length;
+  uint32_t count;
+  uint32_t index;
+  uint32_t slot;
 
-  tag                               = atomic_load_explicit(&descriptor->tag, memory_order_relaxed);
-  descriptor->identifier            = (uint64_t)descriptor | ((uint64_t)tag | (uint64_t)tag << 42) & RING_DESC_INTEGRITY_MASK;
-  descriptor->submission.user_data  = (uint64_t)descriptor->identifier | (uint64_t)(option & RING_DESC_OPTION_MASK);
+  if ((caches == NULL) ||
+      ((caches->count + 1) * 2 > (caches->mask + 1)))
+  {
+    // Keep the map at most half full, entries of released owners are dropped on the way
+    count  = 1;
+    length = CACHE_MAP_LENGTH;
 
-  atomic_store_explicit(&descriptor->state, RING_DESC_STATE_PENDING, memory_order_release);
+    for (index = 0; (caches != NULL) && (index <= caches->mask); index ++)
+      count += (caches->entries[index].cache != NULL) && (atomic_load_explicit(&caches->entries[index].cache->state, memory_order_acquire) != RING_CACHE_DETACHED);
+
+    while (count * 2 > length)
+      length <<= 1;
+
+    if (unlikely((other = (struct RingCacheMap*)calloc(1, sizeof(struct RingCacheMap) + length * sizeof(other->entries[0]))) == NULL))
+    {
+      // Allocation failed, the caller falls back to the shared stack
+      return -ENOMEM;
+    }
+
+    other->mask = length - 1;
+
+    for (index = 0; (caches != NULL) && (index <= caches->mask); index ++)
+    {
+      if ((current = caches->entries[index].cache) &&
+          (atomic_load_explicit(&current->state, memory_order_acquire) == RING_CACHE_DETACHED))
+      {
+        // Released owner has left the cache to the thread
+        free(current);
+        continue;
+      }
+
+      if (current != NULL)
+      {
+        slot = caches->entries[index].serial & other->mask;
+
+        while (other->entries[slot].cache != NULL)
+          slot = (slot + 1) & other->mask;
+
+        other->entries[slot] = caches->entries[index];
+        other->count ++;
+      }
+    }
+
+    pthread_once(&once, CreateRingCacheKey);
+    pthread_setspecific(key, other);
+    free(caches);
+    caches = other;
+  }
+
+  slot = number & caches->mask;
+
+  while (caches->entries[slot].cache != NULL)
+    slot = (slot + 1) & caches->mask;
+
+  caches->entries[slot].serial = number;
+  caches->entries[slot].cache  = cache;
+  caches->count ++;
+
+  return 0;
 }
 
-static inline __attribute__((always_inline)) int LockPendingRingDescriptor(struct FastRingDescriptor* descriptor)
+static struct FastRingCache* __attribute__((noinline)) FindRingCache(struct FastRingCacheList* list)
 {
-  uint32_t state;
+  uint32_t slot;
 
-  state = RING_DESC_STATE_PENDING;
+  for (slot = list->serial & (caches != NULL ? caches->mask : 0); (caches != NULL) && (caches->entries[slot].cache != NULL); slot = (slot + 1) & caches->mask)
+  {
+    if (caches->entries[slot].serial == list->serial)
+    {
+      // Probed past a colliding entry
+      return caches->entries[slot].cache;
+    }
+  }
 
-  return atomic_compare_exchange_strong_explicit(&descriptor->state, &state, RING_DESC_STATE_LOCKED, memory_order_acquire, memory_order_relaxed);
+  return NULL;
 }
 
-static inline __attribute__((always_inline)) int LockSubmittedRingDescriptor(struct FastRingDescriptor* descriptor)
+static struct FastRingCache* __attribute__((noinline)) CreateRingCache(struct FastRingCacheList* list, size_t size, HandleFastRingCacheFunction function, void* owner)
 {
+  struct FastRingCache* cache;
   uint32_t state;
 
-  state = RING_DESC_STATE_SUBMITTED;
-
-  while (!atomic_compare_exchange_strong_explicit(&descriptor->state, &state, RING_DESC_STATE_LOCKED, memory_order_acquire, memory_order_relaxed))
+  for (cache = atomic_load_explicit(&list->top, memory_order_acquire); cache != NULL; cache = cache->next)
   {
-    if (state != RING_DESC_STATE_LOCKED)
+    state = RING_CACHE_ABANDONED;
+
+    if (atomic_compare_exchange_strong_explicit(&cache->state, &state, RING_CACHE_ACTIVE, memory_order_acquire, memory_order_relaxed))
     {
-      // Unexpected state of descriptor
-      return 0;
+      // Reuse a cache of an exited thread, it was flushed on exit
+      break;
     }
+  }
 
-#if defined(__x86_64__) || defined(__i386__)
-    __builtin_ia32_pause();
-#elif defined(__aarch64__) || defined(__arm__)
-    __asm__ __volatile__("yield");
-#else
-    __asm__ __volatile__("" ::: "memory");
-#endif
+  if ((cache == NULL) &&
+      (cache = (struct FastRingCache*)calloc(1, size)))
+  {
+    // Cache is never removed from the list until ReleaseFastRingCacheList(), so the list can be read without locks
+    cache->owner    = owner;
+    cache->function = function;
 
-    state = RING_DESC_STATE_SUBMITTED;
+    do cache->next = atomic_load_explicit(&list->top, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&list->top, &cache->next, cache, memory_order_release, memory_order_relaxed));
   }
 
-  return 1;
+  if (unlikely((cache != NULL) &&
+               (InsertRingCache(list->serial, cache) != 0)))
+  {
+    // Leave the cache to the next thread
+    atomic_store_explicit(&cache->state, RING_CACHE_ABANDONED, memory_order_release);
+    cache = NULL;
+  }
+
+  return cache;
 }
 
-static inline __attribute__((hot)) void HandleCompletedRingDescriptor(struct FastRing* ring, struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+static inline __attribute__((always_inline)) struct FastRingCache* GetRingCache(struct FastRingCacheList* list)
 {
-  __builtin_prefetch(&descriptor->state);
+  struct RingCacheEntry* entry;
 
-  if (unlikely(ring->trace.function != NULL))
+  // Serial of a list is never reused, so an entry cannot match a different list even after release
+  if (likely((caches != NULL) &&
+             (entry = caches->entries + (list->serial & caches->mask))->serial == list->serial))
   {
-    // Trace is only for debug purposes, less probable it is in use
-    ring->trace.function(RING_TRACE_ACTION_HANDLE, descriptor, completion, reason, ring->trace.closure);
+    //
+    return entry->cache;
   }
 
-  if (unlikely((completion != NULL) &&
-               ((completion->user_data & ~RING_DESC_OPTION_MASK) != descriptor->identifier)))
+  return FindRingCache(list);
+}
+
+static void FlushRingDescriptorCache(struct FastRingCache* cache)
+{
+  struct FastRingDescriptorCache* descriptors;
+
+  descriptors = (struct FastRingDescriptorCache*)cache;
+
+  if (descriptors->count > 0)
   {
-    // Leaked descriptor: someone was not in good mood and forgot to solve some cases
-    // Don't touch the descriptor, it could be still in use somewhere else
-    return;
+    //
+    PushRingDescriptorList((struct FastRingDescriptorSet*)cache->owner, descriptors->stack, descriptors->count);
   }
 
-  if (likely(((descriptor->function == NULL) &&
-              (( completion == NULL) ||
-               (~completion->flags & IORING_CQE_F_MORE)) ||
-              (descriptor->function != NULL) &&
-              (descriptor->function(descriptor, completion, reason) == 0)) &&
-             (atomic_fetch_sub_explicit(&descriptor->references, 1, memory_order_relaxed) == 1)))
-  {
-    if (unlikely(ring->trace.function != NULL))
-    {
-      // Trace is only for debug purposes, less probable it is in use
-      ring->trace.function(RING_TRACE_ACTION_RELEASE, descriptor, completion, reason, ring->trace.closure);
-    }
+  descriptors->count = 0;
+}
 
-    if (unlikely((descriptor->next           != NULL) &&
-                 (descriptor->next->previous == descriptor)))
-    {
-      // This case is useful to handle chains with IOSQE_CQE_SKIP_SUCCESS
-      descriptor->next->previous = NULL;
-    }
+static inline __attribute__((always_inline)) struct FastRingDescriptorCache* GetRingDescriptorCache(struct FastRingDescriptorSet* set)
+{
+  struct FastRingCache* cache;
 
-    descriptor->closure    = NULL;
-    descriptor->function   = NULL;
-    descriptor->previous   = NULL;
-    descriptor->identifier = 0ULL;
+  if (likely(cache = GetRingCache(&set->caches)))
+  {
+    //
+    return (struct FastRingDescriptorCache*)cache;
+  }
 
-    atomic_store_explicit(&descriptor->state, RING_DESC_STATE_FREE, memory_order_release);
-    ReleaseRingDescriptor(&ring->descriptors, descriptor);
+  if (unlikely(atomic_load_explicit(&set->slabs, memory_order_relaxed) == NULL))
+  {
+    // Set is being released, a new cache would be lost
+    return NULL;
   }
+
+  return (struct FastRingDescriptorCache*)CreateRingCache(&set->caches, sizeof(struct FastRingDescriptorCache), FlushRingDescriptorCache, set);
 }
 
-int __attribute__((hot)) WaitForFastRing(struct FastRing* ring, uint32_t interval, sigset_t* mask)
+static struct FastRingDescriptorSlab* CreateRingDescriptorSlab(struct FastRingDescriptorSet* set)
 {
-  int result;
-  unsigned position;
-  struct io_uring_cqe* completion;
-  struct io_uring_sqe* submission;
-  struct __kernel_timespec timeout;
+  struct FastRingDescriptorSlab* slab;
+  void* address;
 
-  uint32_t state;
-  void* condition;
-  struct FastRingFlusher* flusher;
-  struct FastRingDescriptor* previous;
-  struct FastRingDescriptor* descriptor;
+  address = mmap(NULL, RING_DESC_SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
 
-  if (unlikely((ring == NULL) ||
-               (ring->ring.sq.ring_sz == 0)))
+  if ((address == MAP_FAILED) &&
+      (address  = mmap(NULL, RING_DESC_SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) != MAP_FAILED)
   {
-    // Ring is not properly initialised
-    return -EINVAL;
+    // There are no reserved huge pages, try to get transparent ones
+    madvise(address, RING_DESC_SLAB_SIZE, MADV_HUGEPAGE);
   }
 
-  // Check and handle CQ overflow
+  if (unlikely(address == MAP_FAILED))
+  {
+    // Cannot map a new slab
+    return NULL;
+  }
 
-  if (unlikely(io_uring_cq_has_overflow(&ring->ring)))
+  if (unlikely((slab = (struct FastRingDescriptorSlab*)calloc(1, sizeof(struct FastRingDescriptorSlab))) == NULL))
   {
-    result = io_uring_get_events(&ring->ring);
-    if (likely((result == 0) &&
-               (io_uring_cq_ready(&ring->ring) != 0)))
+    munmap(address, RING_DESC_SLAB_SIZE);
+    return NULL;
+  }
+
+  slab->address = (uint8_t*)address;
+  slab->state   = RING_DESC_SLAB_RESIDENT;
+  slab->next    = atomic_load_explicit(&set->slabs, memory_order_relaxed);
+
+  atomic_store_explicit(&set->slabs, slab, memory_order_release);
+  set->count ++;
+
+  return slab;
+}
+
+static int ReserveRingDescriptorSlabs(struct FastRingDescriptorSet* set, uint32_t count)
+{
+  struct FastRingDescriptorSlab* slab;
+  size_t position;
+  size_t length;
+  size_t size;
+
+  for (slab = atomic_load_explicit(&set->slabs, memory_order_relaxed); (slab != NULL) && (set->count < ((count + RING_DESC_SLAB_LENGTH - 1) / RING_DESC_SLAB_LENGTH)); slab = slab->next)
+  {
+    if (slab->state == RING_DESC_SLAB_PARKED)
     {
-      // It seems like io_uring clears IORING_SQ_CQ_OVERFLOW only on call io_uring_submit_and_wait_timeout()
-      goto Handle;
+      // Revive parked slabs first, their mappings and tags are kept
+      slab->state = RING_DESC_SLAB_RESIDENT;
+      set->count ++;
     }
   }
 
-  // Submit pending SQEs
-
-  if (likely((descriptor = atomic_load_explicit(&ring->descriptors.pending, memory_order_relaxed))    &&
-             (atomic_load_explicit(&descriptor->next,  memory_order_acquire) == NULL)                 &&
-             (atomic_load_explicit(&descriptor->state, memory_order_relaxed) != RING_DESC_STATE_FREE) &&
-             (descriptor = AllocateRingDescriptor(&ring->descriptors))))
+  while (set->count < ((count + RING_DESC_SLAB_LENGTH - 1) / RING_DESC_SLAB_LENGTH))
   {
-    // Submit stub descriptor to force submission of last valuable descriptor
-    SubmitRingDescriptorRange(&ring->descriptors, descriptor, descriptor);
+    if (unlikely(CreateRingDescriptorSlab(set) == NULL))
+    {
+      // Mapping failed, probably RLIMIT_AS or vm.max_map_count
+      return -ENOMEM;
+    }
   }
 
-  condition = NULL;
+  size = (size_t)count * RING_DESC_ALIGNMENT;
+  slab = atomic_load_explicit(&set->slabs, memory_order_relaxed);
 
-  while ((descriptor = ring->descriptors.submitting) &&
-         (condition  = atomic_load_explicit(&descriptor->next, memory_order_acquire)))
+  while ((slab != NULL) &&
+         (size  > 0))
   {
-    if (atomic_load_explicit(&descriptor->state, memory_order_relaxed) == RING_DESC_STATE_FREE)
+    if (slab->state == RING_DESC_SLAB_RESIDENT)
+    {
+      // Pre-fault only not carved part, carved descriptors could be in use
+      position = (size_t)slab->position * RING_DESC_ALIGNMENT;
+      length   = (size < RING_DESC_SLAB_SIZE) ? size : RING_DESC_SLAB_SIZE;
+      size    -= length;
+
+      while (position < length)
+      {
+        slab->address[position] = 0;
+        position += getpagesize();
+      }
+    }
+
+    slab = slab->next;
+  }
+
+  return 0;
+}
+
+static uint32_t CarveRingDescriptorList(struct FastRingDescriptorSet* set, struct FastRingDescriptor** list, uint32_t count)
+{
+  struct FastRingDescriptorSlab* slab;
+  struct FastRingDescriptor* descriptor;
+  uint32_t number;
+
+  number = 0;
+
+  pthread_mutex_lock(&set->lock);
+
+  slab = atomic_load_explicit(&set->slabs, memory_order_relaxed);
+
+  while ((slab != NULL) &&
+         ((slab->state    != RING_DESC_SLAB_RESIDENT) ||
+          (slab->position == RING_DESC_SLAB_LENGTH)))
+    slab = slab->next;
+
+  if (unlikely(slab == NULL))
+  {
+    slab = atomic_load_explicit(&set->slabs, memory_order_relaxed);
+
+    while ((slab != NULL) &&
+           (slab->state != RING_DESC_SLAB_PARKED))
+      slab = slab->next;
+
+    if (slab != NULL)
+    {
+      // Revive a parked slab, its memory is already mapped
+      slab->state = RING_DESC_SLAB_RESIDENT;
+      set->count ++;
+    }
+    else if (atomic_load_explicit(&set->slabs, memory_order_relaxed) != NULL)
+    {
+      // Set is not released yet, map a new slab
+      slab = CreateRingDescriptorSlab(set);
+    }
+  }
+
+  while ((slab   != NULL)  &&
+         (number <  count) &&
+         (slab->position < RING_DESC_SLAB_LENGTH))
+  {
+    descriptor = (struct FastRingDescriptor*)(slab->address + (size_t)slab->position * RING_DESC_ALIGNMENT);
+
+    memset(descriptor, 0, sizeof(struct FastRingDescriptor));
+
+    // Tag 0 is never used, so stale references to parked descriptors (zero pages) never match
+    descriptor->slab = slab;
+    descriptor->tag  = (slab->tags != NULL) ? slab->tags[slab->position] + 1 : 1;
+
+    list[number ++] = descriptor;
+    slab->position ++;
+  }
+
+  pthread_mutex_unlock(&set->lock);
+
+  RING_STATISTICS_ADD(set->allocated, number);
+  return number;
+}
+
+static void __attribute__((noinline)) TrimRingDescriptorSlabs(struct FastRingDescriptorSet* set)
+{
+  struct FastRingDescriptorCache* cache;
+  struct FastRingDescriptorSlab* slab;
+  struct FastRingDescriptor* descriptor;
+  struct FastRingDescriptor* first;
+  struct FastRingDescriptor* last;
+  struct FastRingDescriptor* next;
+  void* pointer;
+  uint32_t index;
+  uint32_t tag;
+
+  if (pthread_mutex_trylock(&set->lock) != 0)
+  {
+    // Trimming is optional, don't block the ring thread
+    return;
+  }
+
+  if ((cache = GetRingDescriptorCache(set)) &&
+      (cache->count > 0))
+  {
+    // Own cache can be safely flushed, caches of other threads keep their slabs resident
+    PushRingDescriptorList(set, cache->stack, cache->count);
+    cache->count = 0;
+  }
+
+  for (slab = atomic_load_explicit(&set->slabs, memory_order_relaxed); slab != NULL; slab = slab->next)
+    slab->count = 0;
+
+  // Slab can be parked only when all its descriptors are in the shared stack, so take the stack exclusively
+
+  pointer = atomic_exchange_explicit(&set->available, NULL, memory_order_acquire);
+
+  for (descriptor = REMOVE_ABA_TAG(struct FastRingDescriptor, pointer, RING_DESC_ALIGNMENT); descriptor != NULL; descriptor = REMOVE_ABA_TAG(struct FastRingDescriptor, descriptor->next, RING_DESC_ALIGNMENT))
+    descriptor->slab->count += (atomic_load_explicit(&descriptor->state, memory_order_relaxed) == RING_DESC_STATE_FREE);
+
+  for (slab = atomic_load_explicit(&set->slabs, memory_order_relaxed); (slab != NULL) && (set->count > set->limit); slab = slab->next)
+  {
+    if ((slab->state    == RING_DESC_SLAB_RESIDENT) &&
+        (slab->count    == slab->position) &&
+        ((slab->tags    != NULL) ||
+         (slab->tags     = (uint32_t*)calloc(RING_DESC_SLAB_LENGTH, sizeof(uint32_t)))))
+    {
+      slab->state = RING_DESC_SLAB_PARKED;
+      set->count --;
+    }
+  }
+
+  first = NULL;
+  last  = NULL;
+
+  for (descriptor = REMOVE_ABA_TAG(struct FastRingDescriptor, pointer, RING_DESC_ALIGNMENT); descriptor != NULL; descriptor = next)
+  {
+    next = REMOVE_ABA_TAG(struct FastRingDescriptor, descriptor->next, RING_DESC_ALIGNMENT);
+
+    if (descriptor->slab->state == RING_DESC_SLAB_RESIDENT)
+    {
+      if (last == NULL)
+      {
+        first = descriptor;
+        last  = descriptor;
+        continue;
+      }
+
+      // Chain is relinked, every descriptor gets a new tag as in PushRingDescriptorList
+      tag        = atomic_fetch_add_explicit(&descriptor->tag, 1, memory_order_relaxed) + 1;
+      last->next = ADD_ABA_TAG(descriptor, tag, RING_DESC_ALIGNMENT);
+      last       = descriptor;
+    }
+  }
+
+  if (last != NULL)
+  {
+    // Change the tag of the top, a thread popping the old top must fail its CAS
+    tag = atomic_fetch_add_explicit(&first->tag, 1, memory_order_relaxed) + 1;
+
+    do last->next = atomic_load_explicit(&set->available, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&set->available, &last->next, ADD_ABA_TAG(first, tag, RING_DESC_ALIGNMENT), memory_order_release, memory_order_relaxed));
+  }
+
+  for (slab = atomic_load_explicit(&set->slabs, memory_order_relaxed); slab != NULL; slab = slab->next)
+  {
+    if ((slab->state    == RING_DESC_SLAB_PARKED) &&
+        (slab->position != 0))
+    {
+      // Keep tags to continue sequences after revival, then give pages back (mapping stays valid for stale readers)
+      for (index = 0; index < slab->position; index ++)
+      {
+        descriptor        = (struct FastRingDescriptor*)(slab->address + (size_t)index * RING_DESC_ALIGNMENT);
+        slab->tags[index] = atomic_load_explicit(&descriptor->tag, memory_order_relaxed);
+        free(descriptor->extension);
+      }
+
+      slab->position = 0;
+      madvise(slab->address, RING_DESC_SLAB_SIZE, MADV_DONTNEED);
+    }
+  }
+
+  pthread_mutex_unlock(&set->lock);
+}
+
+static inline __attribute__((always_inline)) void ReleaseRingDescriptorHeap(struct FastRingDescriptorSet* set)
+{
+  struct FastRingDescriptorSlab* slab;
+  struct FastRingDescriptorSlab* next;
+  struct FastRingDescriptor* current;
+  uint32_t index;
+
+  pthread_mutex_lock(&set->lock);
+  next = atomic_exchange_explicit(&set->slabs, NULL, memory_order_acquire);
+  pthread_mutex_unlock(&set->lock);
+
+  // Per-thread caches only borrow descriptors from slabs, detach them before slabs are gone
+  ReleaseFastRingCacheList(&set->caches, NULL);
+
+  for (slab = next; slab != NULL; slab = slab->next)
+  {
+    for (index = 0; index < slab->position; index ++)
+    {
+      current = (struct FastRingDescriptor*)(slab->address + (size_t)index * RING_DESC_ALIGNMENT);
+
+      if ((current->state    != RING_DESC_STATE_FREE) &&
+          (current->function != NULL))
+      {
+        // Before freeing a descriptor call related handler to complete all incomplete submissions
+        current->function(current, NULL, RING_REASON_RELEASED);
+      }
+    }
+  }
+
+  while (slab = next)
+  {
+    for (index = 0; index < slab->position; index ++)
+    {
+      current = (struct FastRingDescriptor*)(slab->address + (size_t)index * RING_DESC_ALIGNMENT);
+      free(current->extension);
+    }
+
+    next = slab->next;
+    munmap(slab->address, RING_DESC_SLAB_SIZE);
+    free(slab->tags);
+    free(slab);
+  }
+}
+
+static inline __attribute__((always_inline)) struct FastRingDescriptor* AllocateRingDescriptor(struct FastRingDescriptorSet* set)
+{
+  struct FastRingDescriptorCache* cache;
+  struct FastRingDescriptor* descriptor;
+
+  descriptor = NULL;
+
+  if (likely(cache = GetRingDescriptorCache(set)))
+  {
+    if (unlikely((cache->count == 0) &&
+                 (cache->count  = PopRingDescriptorList(set, cache->stack, RING_DESC_CACHE_BATCH)) == 0))
+    {
+      // Shared stack is empty, carve a batch of new descriptors
+      cache->count = CarveRingDescriptorList(set, cache->stack, RING_DESC_CACHE_BATCH);
+    }
+
+    if (likely(cache->count > 0))
+    {
+      cache->count --;
+      descriptor = cache->stack[cache->count];
+      RING_STATISTICS_PUT(cache->hits, 1);
+    }
+  }
+  else if (PopRingDescriptorList(set, &descriptor, 1) == 0)
+  {
+    // Out of memory for a cache, use the shared stack and slabs directly
+    CarveRingDescriptorList(set, &descriptor, 1);
+  }
+
+  if (unlikely((descriptor != NULL) &&
+               (descriptor->state != RING_DESC_STATE_FREE)))
+  {
+    // Descriptor is still in use by someone else, leave it and take a new one
+    descriptor = NULL;
+    CarveRingDescriptorList(set, &descriptor, 1);
+  }
+
+  return descriptor;
+}
+
+static inline __attribute__((always_inline)) void ReleaseRingDescriptor(struct FastRingDescriptorSet* set, struct FastRingDescriptor* descriptor)
+{
+  struct FastRingDescriptorCache* cache;
+
+  // Tag has to be changed on every release, it invalidates stale CQEs (PushRingDescriptorList changes it again for the shared stack)
+  atomic_fetch_add_explicit(&descriptor->tag, 1, memory_order_relaxed);
+
+  if (likely(cache = GetRingDescriptorCache(set)))
+  {
+    if (unlikely(cache->count == RING_DESC_CACHE_LENGTH))
+    {
+      // Flush the coldest half of cache to the shared stack
+      PushRingDescriptorList(set, cache->stack, RING_DESC_CACHE_BATCH);
+      memmove(cache->stack, cache->stack + RING_DESC_CACHE_BATCH, (RING_DESC_CACHE_LENGTH - RING_DESC_CACHE_BATCH) * sizeof(struct FastRingDescriptor*));
+      cache->count -= RING_DESC_CACHE_BATCH;
+    }
+
+    cache->stack[cache->count] = descriptor;
+    cache->count ++;
+    return;
+  }
+
+  PushRingDescriptorList(set, &descriptor, 1);
+}
+
+static inline __attribute__((always_inline)) void SubmitRingDescriptorRange(struct FastRingDescriptorSet* set, struct FastRingDescriptor* first, struct FastRingDescriptor* last)
+{
+  struct FastRingDescriptor* descriptor;
+
+  atomic_store_explicit(&last->next, NULL, memory_order_relaxed);
+  descriptor = atomic_exchange_explicit(&set->pending, last, memory_order_relaxed);
+  atomic_store_explicit(&descriptor->next, first, memory_order_release);
+}
+
+static inline __attribute__((always_inline)) uint64_t MakeRingDescriptorIdentifier(struct FastRingDescriptor* descriptor)
+{
+  uint32_t tag;
+
+  tag                    = atomic_load_explicit(&descriptor->tag, memory_order_relaxed);
+  descriptor->identifier = (uint64_t)descriptor | ((uint64_t)tag | (uint64_t)tag << 43) & RING_DESC_INTEGRITY_MASK;
+
+  return descriptor->identifier;
+}
+
+static inline __attribute__((always_inline)) void PrepareRingDescriptor(struct FastRingDescriptor* descriptor, int option)
+{
+  descriptor->submission.user_data = MakeRingDescriptorIdentifier(descriptor) | (uint64_t)(option & RING_DESC_OPTION_MASK);
+  atomic_store_explicit(&descriptor->state, RING_DESC_STATE_PENDING, memory_order_release);
+}
+
+static inline __attribute__((always_inline)) int LockPendingRingDescriptor(struct FastRingDescriptor* descriptor)
+{
+  uint32_t state;
+
+  state = RING_DESC_STATE_PENDING;
+
+  return atomic_compare_exchange_strong_explicit(&descriptor->state, &state, RING_DESC_STATE_LOCKED, memory_order_acquire, memory_order_relaxed);
+}
+
+static inline __attribute__((always_inline)) int LockSubmittedRingDescriptor(struct FastRingDescriptor* descriptor)
+{
+  uint32_t state;
+
+  state = RING_DESC_STATE_SUBMITTED;
+
+  while (!atomic_compare_exchange_strong_explicit(&descriptor->state, &state, RING_DESC_STATE_LOCKED, memory_order_acquire, memory_order_relaxed))
+  {
+    if (state != RING_DESC_STATE_LOCKED)
+    {
+      // Unexpected state of descriptor
+      return 0;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+
+    state = RING_DESC_STATE_SUBMITTED;
+  }
+
+  return 1;
+}
+
+static inline __attribute__((hot)) void HandleCompletedRingDescriptor(struct FastRing* ring, struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  if (unlikely(ring->trace.function != NULL))
+  {
+    // Trace is only for debug purposes, less probable it is in use
+    ring->trace.function(RING_TRACE_ACTION_HANDLE, descriptor, completion, reason, ring->trace.closure);
+  }
+
+  if (unlikely((completion != NULL) &&
+               ((completion->user_data & ~RING_DESC_OPTION_MASK) != descriptor->identifier)))
+  {
+    // Leaked descriptor: someone was not in good mood and forgot to solve some cases
+    // Don't touch the descriptor, it could be still in use somewhere else
+    return;
+  }
+
+  if (likely(((descriptor->function == NULL) &&
+              (( completion == NULL) ||
+               (~completion->flags & IORING_CQE_F_MORE)) ||
+              (descriptor->function != NULL) &&
+              (descriptor->function(descriptor, completion, reason) == 0)) &&
+             (atomic_fetch_sub_explicit(&descriptor->references, 1, memory_order_relaxed) == 1)))
+  {
+    if (unlikely(ring->trace.function != NULL))
+    {
+      // Trace is only for debug purposes, less probable it is in use
+      ring->trace.function(RING_TRACE_ACTION_RELEASE, descriptor, completion, reason, ring->trace.closure);
+    }
+
+    if (unlikely((descriptor->next           != NULL) &&
+                 (descriptor->next->previous == descriptor)))
+    {
+      // This case is useful to handle chains with IOSQE_CQE_SKIP_SUCCESS
+      descriptor->next->previous = NULL;
+    }
+
+    descriptor->closure    = NULL;
+    descriptor->function   = NULL;
+    descriptor->previous   = NULL;
+    descriptor->identifier = 0ULL;
+
+    atomic_store_explicit(&descriptor->state, RING_DESC_STATE_FREE, memory_order_release);
+    ReleaseRingDescriptor(&ring->descriptors, descriptor);
+  }
+}
+
+#ifdef RING_FEATURE_STATISTICS
+static inline __attribute__((always_inline)) uint64_t GetRingTime()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+}
+
+static inline __attribute__((always_inline)) uint32_t GetRingStatisticsBucket(uint64_t value)
+{
+  uint32_t exponent;
+  uint32_t index;
+
+  // Log-linear: 2^RING_STATISTICS_HISTOGRAM_SHIFT linear buckets per every power of 2
+
+  if (value < (1ULL << RING_STATISTICS_HISTOGRAM_SHIFT))
+  {
+    //
+    return value;
+  }
+
+  exponent = 63 - __builtin_clzll(value);
+  index    = ((exponent - RING_STATISTICS_HISTOGRAM_SHIFT + 1) << RING_STATISTICS_HISTOGRAM_SHIFT) |
+             ((value >> (exponent - RING_STATISTICS_HISTOGRAM_SHIFT)) & ((1ULL << RING_STATISTICS_HISTOGRAM_SHIFT) - 1));
+
+  return (index < RING_STATISTICS_HISTOGRAM_LENGTH) ? index : (RING_STATISTICS_HISTOGRAM_LENGTH - 1);
+}
+
+static inline __attribute__((always_inline)) void StampRingDescriptor(struct FastRingDescriptor* descriptor, uint32_t opcode, uint64_t time)
+{
+  if (likely(descriptor->length == sizeof(struct io_uring_sqe)))
+  {
+    // Stamp shares the place with the second half of 128-byte SQE
+    descriptor->stamp.time   = time;
+    descriptor->stamp.opcode = opcode;
+  }
+}
+
+static inline __attribute__((always_inline)) void CountRingCompletion(struct FastRing* ring, struct io_uring_cqe* completion, uint64_t time)
+{
+  struct FastRingDescriptor* descriptor;
+  uint32_t opcode;
+
+  RING_STATISTICS_PUT(ring->statistics.completions, 1);
+
+  descriptor = (struct FastRingDescriptor*)(completion->user_data & RING_DATA_ADDRESS_MASK);
+
+  if ((completion->user_data < RING_DATA_UNDEFINED)                                     &&
+      (descriptor->length    == sizeof(struct io_uring_sqe))                            &&
+      (descriptor->stamp.time != 0)                                                     &&
+      ((completion->user_data & ~RING_DESC_OPTION_MASK) == descriptor->identifier) &&
+      (~completion->flags & IORING_CQE_F_MORE))
+  {
+    // Only the last CQE of request is counted, handler can submit the descriptor again
+    opcode = (descriptor->stamp.opcode < RING_STATISTICS_OPCODE_COUNT) ? descriptor->stamp.opcode : (RING_STATISTICS_OPCODE_COUNT - 1);
+    time   = (time > descriptor->stamp.time) ? (time - descriptor->stamp.time) : 0;
+
+    RING_STATISTICS_PUT(ring->statistics.histograms[opcode][GetRingStatisticsBucket(time)], 1);
+    descriptor->stamp.time = 0;
+  }
+}
+#endif
+
+static inline __attribute__((always_inline)) struct io_uring_cqe* GetRingCompletion(struct FastRing* ring, unsigned position, unsigned shift)
+{
+  // The same as io_uring_for_each_cqe(), positions are free-running
+  return ring->ring.cq.cqes + ((position & ring->ring.cq.ring_mask) << shift);
+}
+
+static inline __attribute__((always_inline)) void PrefetchRingCompletion(struct io_uring_cqe* completion)
+{
+  // Prefetch never faults, so there is no need to check user_data, header is going to be updated by handling
+  __builtin_prefetch((void*)(completion->user_data & RING_DATA_ADDRESS_MASK), 1);
+}
+
+static inline __attribute__((always_inline)) void PrefetchRingCompletionClosure(struct io_uring_cqe* completion)
+{
+  struct FastRingDescriptor* descriptor;
+
+  if (likely(completion->user_data < RING_DATA_UNDEFINED))
+  {
+    // Descriptor line has to be prefetched well before (see WaitForFastRing), otherwise reading closure stalls.
+    // Descriptor memory stays mapped while the ring exists, even stale closure is harmless for prefetch
+    descriptor = (struct FastRingDescriptor*)(completion->user_data & RING_DATA_ADDRESS_MASK);
+    __builtin_prefetch(descriptor->closure);
+  }
+}
+
+static inline __attribute__((always_inline)) void HandleRingCompletion(struct FastRing* ring, struct io_uring_cqe* completion)
+{
+  struct FastRingDescriptor* previous;
+  struct FastRingDescriptor* descriptor;
+
+  if (likely(completion->user_data < RING_DATA_UNDEFINED))
+  {
+    descriptor = (struct FastRingDescriptor*)(completion->user_data & RING_DATA_ADDRESS_MASK);
+    previous   = descriptor->previous;
+
+    HandleCompletedRingDescriptor(ring, descriptor, completion, RING_REASON_COMPLETE);
+
+    while (previous != NULL)
+    {
+      descriptor = previous;
+      previous   = descriptor->previous;
+
+      HandleCompletedRingDescriptor(ring, descriptor, NULL, RING_REASON_COMPLETE);
+    }
+  }
+}
+
+static void HandleRingPollReadiness(struct FastRing* ring);
+
+int __attribute__((hot)) WaitForFastRing(struct FastRing* ring, uint32_t interval, sigset_t* mask)
+{
+  int result;
+  unsigned count;
+  unsigned index;
+  unsigned position;
+  unsigned head;
+  unsigned shift;
+  struct io_uring_cqe* completion;
+  struct io_uring_sqe* submission;
+  struct __kernel_timespec timeout;
+
+  uint32_t state;
+  void* condition;
+  struct FastRingFlusher* flusher;
+  struct FastRingDescriptor* descriptor;
+
+#ifdef RING_FEATURE_STATISTICS
+  uint64_t time;
+  uint32_t depth;
+#endif
+
+  if (unlikely((ring == NULL) ||
+               (ring->ring.sq.ring_sz == 0)))
+  {
+    // Ring is not properly initialised
+    return -EINVAL;
+  }
+
+  // Check and handle CQ overflow
+
+  if (unlikely(io_uring_cq_has_overflow(&ring->ring)))
+  {
+    RING_STATISTICS_PUT(ring->statistics.overflows, 1);
+    RING_STATISTICS_PUT(ring->statistics.calls, 1);
+
+    result = io_uring_get_events(&ring->ring);
+    if (likely((result == 0) &&
+               (io_uring_cq_ready(&ring->ring) != 0)))
+    {
+      // It seems like io_uring clears IORING_SQ_CQ_OVERFLOW only on call io_uring_submit_and_wait_timeout()
+      goto Handle;
+    }
+  }
+
+  // Submit pending SQEs
+
+  if (likely((descriptor = atomic_load_explicit(&ring->descriptors.pending, memory_order_relaxed))    &&
+             (atomic_load_explicit(&descriptor->next,  memory_order_acquire) == NULL)                 &&
+             (atomic_load_explicit(&descriptor->state, memory_order_relaxed) != RING_DESC_STATE_FREE) &&
+             (descriptor = AllocateRingDescriptor(&ring->descriptors))))
+  {
+    // Submit stub descriptor to force submission of last valuable descriptor
+    SubmitRingDescriptorRange(&ring->descriptors, descriptor, descriptor);
+  }
+
+  condition = NULL;
+
+#ifdef RING_FEATURE_STATISTICS
+  time  = GetRingTime();
+  depth = 0;
+#endif
+
+  while ((descriptor = ring->descriptors.submitting) &&
+         (condition  = atomic_load_explicit(&descriptor->next, memory_order_acquire)))
+  {
+    if (atomic_load_explicit(&descriptor->state, memory_order_relaxed) == RING_DESC_STATE_FREE)
     {
       ring->descriptors.submitting = atomic_load_explicit(&descriptor->next, memory_order_relaxed);
       ReleaseRingDescriptor(&ring->descriptors, descriptor);
@@ -343,6 +1207,11 @@ int __attribute__((hot)) WaitForFastRing(struct FastRing* ring, uint32_t interva
         default:                                          memcpy(submission, &descriptor->submission, descriptor->length);                break;
       }
 
+#ifdef RING_FEATURE_STATISTICS
+      StampRingDescriptor(descriptor, submission->opcode, time);
+      depth ++;
+#endif
+
       atomic_store_explicit(&descriptor->state, RING_DESC_STATE_SUBMITTED, memory_order_release);
       continue;
     }
@@ -350,47 +1219,129 @@ int __attribute__((hot)) WaitForFastRing(struct FastRing* ring, uint32_t interva
     break;
   }
 
-  // Submit SQEs and handle CQEs without waiting when at least one pending SQE or CQE exists
+#ifdef RING_FEATURE_STATISTICS
+  RING_STATISTICS_PUT(ring->statistics.submissions, depth);
+  atomic_store_explicit(&ring->statistics.depth, depth, memory_order_relaxed);
+
+  if (unlikely(depth > atomic_load_explicit(&ring->statistics.peak, memory_order_relaxed)))
+  {
+    //
+    atomic_store_explicit(&ring->statistics.peak, depth, memory_order_relaxed);
+  }
+#endif
+
+  // Submit SQEs and handle CQEs without waiting when at least one pending SQE or CQE exists,
+  // SQ polling thread consumes SQEs by itself, so there is no reason to enter the kernel when interval is 0
+  // (io_uring_submit() wakes the thread up when IORING_SQ_NEED_WAKEUP is set)
 
   if (likely((condition != NULL) &&
              (io_uring_sq_ready(&ring->ring) > 0) ||
-             (io_uring_cq_ready(&ring->ring) > 0)))
+             (io_uring_cq_ready(&ring->ring) > 0) ||
+             (interval == 0) &&
+             (ring->parameters.flags & IORING_SETUP_SQPOLL)))
   {
-    result = io_uring_submit(&ring->ring);
+    RING_STATISTICS_PUT(ring->statistics.calls, 1);
+
+    // With IORING_SETUP_DEFER_TASKRUN completions are posted only while getting events
+    result = (ring->parameters.flags & IORING_SETUP_DEFER_TASKRUN) ?
+      io_uring_submit_and_get_events(&ring->ring) :
+      io_uring_submit(&ring->ring);
     goto Handle;
   }
 
-  // Wait for CQEs
+  // Wait for CQEs, readiness of RING_POLL_LEVEL handles has to be delivered without waiting
+
+  interval *= (ring->files.ready == NULL);
 
   timeout.tv_sec  =  interval / 1000;
   timeout.tv_nsec = (interval % 1000) * 1000000;
 
+  RING_STATISTICS_PUT(ring->statistics.calls, 1);
+
   result = io_uring_submit_and_wait_timeout(&ring->ring, &completion, 1, &timeout, mask);
 
   // Handle CQEs
 
   Handle:
 
-  io_uring_for_each_cqe(&ring->ring, position, completion)
+  if (unlikely(ring->files.ready != NULL))
+  {
+    // Readiness queued by the previous call
+    HandleRingPollReadiness(ring);
+  }
+
+  if (unlikely(ring->mode & RING_MODE_EARLY_ADVANCE))
   {
-    if (likely(completion->user_data < RING_DATA_UNDEFINED))
+#ifdef RING_FEATURE_STATISTICS
+    time = GetRingTime();
+#endif
+
+    io_uring_for_each_cqe(&ring->ring, position, completion)
     {
-      descriptor = (struct FastRingDescriptor*)(completion->user_data & RING_DATA_ADDRESS_MASK);
-      previous   = descriptor->previous;
+#ifdef RING_FEATURE_STATISTICS
+      CountRingCompletion(ring, completion, time);
+#endif
+
+      HandleRingCompletion(ring, completion);
+
+      // Release a CQE ASAP, CQ head is a store-release to the shared page per CQE
+      io_uring_cq_advance(&ring->ring, 1);
+    }
+  }
+  else
+  {
+    // Pipeline runs over everything ready in CQ, so it doesn't restart at every batch boundary
+
+    shift = !!(ring->ring.flags & IORING_SETUP_CQE32);
 
-      HandleCompletedRingDescriptor(ring, descriptor, completion, RING_REASON_COMPLETE);
+    while (count = io_uring_cq_ready(&ring->ring))
+    {
+      head = *ring->ring.cq.khead;
+
+#ifdef RING_FEATURE_STATISTICS
+      time = GetRingTime();
+#endif
 
-      while (previous != NULL)
+      for (index = 0; (index < count) && (index < RING_CQE_PREFETCH_DISTANCE * 2); ++ index)
       {
-        descriptor = previous;
-        previous   = descriptor->previous;
+        //
+        PrefetchRingCompletion(GetRingCompletion(ring, head + index, shift));
+      }
+
+      for (index = 0; index < count; ++ index)
+      {
+        // Software pipeline: descriptor of CQE i + 2 * distance is being fetched, descriptor of CQE i + distance
+        // was fetched distance CQEs ago and has arrived, so its closure can be read without a stall, CQE i is handled
 
-        HandleCompletedRingDescriptor(ring, descriptor, NULL, RING_REASON_COMPLETE);
+        if (likely(index + RING_CQE_PREFETCH_DISTANCE * 2 < count))
+        {
+          //
+          PrefetchRingCompletion(GetRingCompletion(ring, head + index + RING_CQE_PREFETCH_DISTANCE * 2, shift));
+        }
+
+        if (likely(index + RING_CQE_PREFETCH_DISTANCE < count))
+        {
+          //
+          PrefetchRingCompletionClosure(GetRingCompletion(ring, head + index + RING_CQE_PREFETCH_DISTANCE, shift));
+        }
+
+        completion = GetRingCompletion(ring, head + index, shift);
+
+#ifdef RING_FEATURE_STATISTICS
+        CountRingCompletion(ring, completion, time);
+#endif
+
+        HandleRingCompletion(ring, completion);
+
+        if (unlikely(((index + 1) % RING_CQE_BATCH_LENGTH) == 0))
+        {
+          // CQ head is advanced once per batch
+          io_uring_cq_advance(&ring->ring, RING_CQE_BATCH_LENGTH);
+        }
       }
-    }
 
-    // Advance is not so expensive, it is better to release a CQE ASAP
-    io_uring_cq_advance(&ring->ring, 1);
+      io_uring_cq_advance(&ring->ring, count % RING_CQE_BATCH_LENGTH);
+    }
   }
 
   // Call flushers
@@ -401,12 +1352,23 @@ int __attribute__((hot)) WaitForFastRing(struct FastRing* ring, uint32_t interva
     {
       // Flusher might be canceled by setting state to RING_FLUSH_STATE_FREE
       flusher->function(flusher->closure, RING_REASON_COMPLETE);
+      RING_STATISTICS_PUT(ring->statistics.flushes, 1);
     }
 
     atomic_store_explicit(&flusher->state, RING_FLUSH_STATE_FREE, memory_order_relaxed);
     PushRingFlusher(&ring->flushers.available, flusher, 0);
   }
 
+  // Give memory of bursts back when ring is idle
+
+  if (unlikely((result == -ETIME) &&
+               (ring->descriptors.limit != 0) &&
+               (ring->descriptors.count > ring->descriptors.limit)))
+  {
+    //
+    TrimRingDescriptorSlabs(&ring->descriptors);
+  }
+
   return result * (result != -ETIME);
 }
 
@@ -434,6 +1396,63 @@ void __attribute__((hot)) SubmitFastRingDescriptorRange(struct FastRingDescripto
   SubmitRingDescriptorRange(&ring->descriptors, first, last);
 }
 
+struct io_uring_sqe* __attribute__((hot)) GetFastRingSubmission(struct FastRingDescriptor* descriptor)
+{
+  struct FastRing* ring;
+  struct io_uring_sqe* submission;
+  struct FastRingDescriptor* head;
+
+  ring = descriptor->ring;
+
+  // Kernel's SQE can be used only by the ring thread and only when nothing waits in the pending queue,
+  // otherwise the SQE would overtake descriptors submitted before
+
+  if (likely((IsFastRingThread(ring) > 0) &&
+             ((head = ring->descriptors.submitting) == atomic_load_explicit(&ring->descriptors.pending, memory_order_acquire)) &&
+             (atomic_load_explicit(&head->state, memory_order_relaxed) == RING_DESC_STATE_FREE) &&
+             (submission = io_uring_get_sqe(&ring->ring))))
+  {
+    //
+    return submission;
+  }
+
+  return &descriptor->submission;
+}
+
+void __attribute__((hot)) CommitFastRingSubmission(struct FastRingDescriptor* descriptor, struct io_uring_sqe* submission, int option)
+{
+  struct FastRing* ring;
+
+  ring = descriptor->ring;
+
+  if (unlikely(submission == &descriptor->submission))
+  {
+    // SQ was full or the queue was not empty, fall back to the pending queue
+    PrepareRingDescriptor(descriptor, option);
+    SubmitRingDescriptorRange(&ring->descriptors, descriptor, descriptor);
+    return;
+  }
+
+  submission->user_data = MakeRingDescriptorIdentifier(descriptor) | (uint64_t)(option & RING_DESC_OPTION_MASK);
+
+  // Handlers inspect and re-submit descriptor's copy (multishot re-arm, poll, timeouts), keep it in sync with the SQE.
+  // Written line is already owned by the ring thread, the copy is much cheaper than the pending queue round trip
+
+  switch (descriptor->length)
+  {
+    case sizeof(struct io_uring_sqe):       __builtin_memcpy(&descriptor->submission, submission, sizeof(struct io_uring_sqe));       break;
+    case sizeof(struct io_uring_sqe) + 64:  __builtin_memcpy(&descriptor->submission, submission, sizeof(struct io_uring_sqe) + 64);  break;
+    default:                                          memcpy(&descriptor->submission, submission, descriptor->length);                break;
+  }
+
+#ifdef RING_FEATURE_STATISTICS
+  StampRingDescriptor(descriptor, submission->opcode, GetRingTime());
+  RING_STATISTICS_PUT(ring->statistics.submissions, 1);
+#endif
+
+  atomic_store_explicit(&descriptor->state, RING_DESC_STATE_SUBMITTED, memory_order_release);
+}
+
 struct FastRingDescriptor* __attribute__((hot)) AllocateFastRingDescriptor(struct FastRing* ring, HandleFastRingCompletionFunction function, void* closure)
 {
   struct FastRingDescriptor* descriptor;
@@ -441,7 +1460,7 @@ struct FastRingDescriptor* __attribute__((hot)) AllocateFastRingDescriptor(struc
   descriptor = NULL;
 
   if (likely((ring != NULL) &&
-             (atomic_load_explicit(&ring->descriptors.heap, memory_order_relaxed)) &&
+             (atomic_load_explicit(&ring->descriptors.slabs, memory_order_relaxed)) &&
              (descriptor = AllocateRingDescriptor(&ring->descriptors))))
   {
     descriptor->ring     = ring;
@@ -461,6 +1480,17 @@ struct FastRingDescriptor* __attribute__((hot)) AllocateFastRingDescriptor(struc
   return descriptor;
 }
 
+union FastRingExtension* GetFastRingDescriptorExtension(struct FastRingDescriptor* descriptor)
+{
+  // Extension stays with the descriptor when it is recycled, it is freed only with its slab
+  // (when the slab is parked or the ring is released), contents are not cleared on recycling
+
+  if (unlikely(descriptor->extension == NULL))
+    descriptor->extension = (union FastRingExtension*)calloc(1, sizeof(union FastRingExtension));
+
+  return descriptor->extension;
+}
+
 int __attribute__((hot)) ReleaseFastRingDescriptor(struct FastRingDescriptor* descriptor)
 {
   struct FastRing* ring;
@@ -539,23 +1569,64 @@ int IsFastRingThread(struct FastRing* ring)
 }
 
 struct FastRing* CreateFastRing(uint32_t length)
+{
+  struct FastRingParameters parameters;
+
+  parameters.length = length;
+  parameters.mode   = RING_MODE_DEFAULT;
+  parameters.cpu    = -1;
+  parameters.idle   = 0;
+
+  return CreateFastRingEx(&parameters);
+}
+
+struct FastRing* CreateFastRingEx(struct FastRingParameters* parameters)
 {
   pthread_mutexattr_t attribute;
   struct FastRing* ring;
   struct rlimit limit;
+  uint32_t length;
+
+  if ((parameters == NULL) ||
+      (parameters->mode & RING_MODE_SQPOLL) &&
+      (parameters->mode & RING_MODE_DEFER_TASKRUN))
+  {
+    // SQ polling thread runs task work by itself, these modes are mutually exclusive
+    return NULL;
+  }
 
   memset(&limit, 0, sizeof(struct rlimit));
   getrlimit(RLIMIT_NOFILE, &limit);
 
   if (ring = (struct FastRing*)calloc(1, sizeof(struct FastRing)))
   {
+    length = parameters->length;
     length = (length != 0) ? length : limit.rlim_cur;
     length = (length == 0) || (length > RING_MAXIMUM_LENGTH) ? RING_MAXIMUM_LENGTH : length;
     length = (length <= 1) ? length : (1U << (32 - __builtin_clz(length - 1)));
 
-    ring->parameters.flags      = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_CQSIZE;
+    ring->mode                  = parameters->mode;
+    ring->parameters.flags      = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_CQSIZE;
     ring->parameters.cq_entries = length * RING_COMPLETION_RATIO;
 
+    if (parameters->mode & RING_MODE_SQPOLL)
+    {
+      // IPI related flags don't make sense with SQ polling thread
+      ring->parameters.flags          |= IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF * (parameters->cpu >= 0);
+      ring->parameters.sq_thread_cpu   = (parameters->cpu >= 0) ? parameters->cpu : 0;
+      ring->parameters.sq_thread_idle  = parameters->idle;
+    }
+    else if (parameters->mode & RING_MODE_DEFER_TASKRUN)
+    {
+      // Task work is run only when the ring thread enters the kernel to get events
+      ring->parameters.flags |= IORING_SETUP_DEFER_TASKRUN;
+    }
+    else
+    {
+      //
+      ring->parameters.flags |= IORING_SETUP_COOP_TASKRUN;
+    }
+
     if (io_uring_queue_init_params(length, &ring->ring, &ring->parameters) < 0)
     {
       free(ring);
@@ -574,11 +1645,25 @@ struct FastRing* CreateFastRing(uint32_t length)
     pthread_mutexattr_init(&attribute);
     pthread_mutexattr_settype(&attribute, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&ring->buffers.lock, &attribute);
-    pthread_mutex_init(&ring->files.lock, &attribute);
     pthread_mutexattr_destroy(&attribute);
+    pthread_mutex_init(&ring->descriptors.lock, NULL);
+    pthread_mutex_init(&ring->files.lock, NULL);
 
     ring->probe                  = io_uring_get_probe_ring(&ring->ring);
     ring->thread                 = gettid();
+    ring->buffers.node           = -1;
+
+    // Ring is created by its thread, arena regions follow the thread's node (there is no glibc wrapper)
+    syscall(SYS_getcpu, NULL, &ring->buffers.node, NULL);
+    InitializeFastRingCacheList(&ring->descriptors.caches);
+
+    if (ReserveRingDescriptorSlabs(&ring->descriptors, length) != 0)
+    {
+      // At least one slab is required to carve descriptors
+      ReleaseFastRing(ring);
+      return NULL;
+    }
+
     ring->descriptors.submitting = AllocateRingDescriptor(&ring->descriptors);
 
     atomic_store_explicit(&ring->descriptors.pending, ring->descriptors.submitting, memory_order_release);
@@ -594,22 +1679,268 @@ void ReleaseFastRing(struct FastRing* ring)
     ReleaseRingFlusherStack(&ring->flushers.pending);
     ReleaseRingFlusherStack(&ring->flushers.available);
     ReleaseRingDescriptorHeap(&ring->descriptors);
+    pthread_mutex_destroy(&ring->descriptors.lock);
     pthread_mutex_destroy(&ring->buffers.lock);
     pthread_mutex_destroy(&ring->files.lock);
     io_uring_free_probe(ring->probe);
     io_uring_queue_exit(&ring->ring);
     free(ring->buffers.vectors);
-    free(ring->files.entries);
-    free(ring->files.filters);
+    ReleaseRingBufferRegions(&ring->buffers);
+    ReleaseRingFileList(&ring->files);
+    free(ring->timers);
     free(ring);
   }
 }
 
+int ReserveFastRingDescriptors(struct FastRing* ring, uint32_t count, uint32_t limit)
+{
+  int result;
+
+  if (unlikely((ring == NULL) ||
+               (atomic_load_explicit(&ring->descriptors.slabs, memory_order_relaxed) == NULL)))
+  {
+    // Ring is not properly initialised
+    return -EINVAL;
+  }
+
+  limit = (limit != 0) && (limit < count) ? count : limit;
+
+  pthread_mutex_lock(&ring->descriptors.lock);
+  ring->descriptors.limit = (limit + RING_DESC_SLAB_LENGTH - 1) / RING_DESC_SLAB_LENGTH;
+  result                  = ReserveRingDescriptorSlabs(&ring->descriptors, count);
+  pthread_mutex_unlock(&ring->descriptors.lock);
+
+  return result;
+}
+
+void InitializeFastRingCacheList(struct FastRingCacheList* list)
+{
+  atomic_store_explicit(&list->top, NULL, memory_order_relaxed);
+  list->serial = atomic_fetch_add_explicit(&serial, 1, memory_order_relaxed) + 1;
+}
+
+void ReleaseFastRingCacheList(struct FastRingCacheList* list, HandleFastRingCacheFunction function)
+{
+  struct FastRingCache* cache;
+  struct FastRingCache* following;
+  uint32_t state;
+
+  // Caches are claimed by RING_CACHE_FLUSHING before they are touched: the thread of an active cache
+  // frees it only after RING_CACHE_DETACHED, so the cache is never read after it is published
+
+  cache = atomic_exchange_explicit(&list->top, NULL, memory_order_acquire);
+
+  while (following = cache)
+  {
+    cache = following->next;
+    state = atomic_load_explicit(&following->state, memory_order_relaxed);
+
+    do
+    {
+      while (state == RING_CACHE_FLUSHING)
+      {
+        // Exiting thread is giving its objects back
+        sched_yield();
+        state = atomic_load_explicit(&following->state, memory_order_relaxed);
+      }
+    }
+    while (!atomic_compare_exchange_weak_explicit(&following->state, &state, RING_CACHE_FLUSHING, memory_order_acquire, memory_order_relaxed));
+
+    if (function != NULL)
+    {
+      // Drain objects held by the cache
+      function(following);
+    }
+
+    if (state == RING_CACHE_ABANDONED)
+    {
+      // Owning thread has exited, otherwise the cache is freed by the thread
+      free(following);
+      continue;
+    }
+
+    atomic_store_explicit(&following->state, RING_CACHE_DETACHED, memory_order_release);
+  }
+}
+
+struct FastRingCache* GetFastRingCache(struct FastRingCacheList* list, size_t size, HandleFastRingCacheFunction function, void* owner)
+{
+  struct FastRingCache* cache;
+
+  if (likely(cache = GetRingCache(list)))
+  {
+    //
+    return cache;
+  }
+
+  return CreateRingCache(list, size, function, owner);
+}
+
+#ifdef RING_FEATURE_STATISTICS
+int GetFastRingStatistics(struct FastRing* ring, struct FastRingStatistics* snapshot)
+{
+  struct FastRingCache* cache;
+  uint64_t cached;
+  uint32_t opcode;
+  uint32_t index;
+
+  if (unlikely((ring     == NULL) ||
+               (snapshot == NULL)))
+  {
+    //
+    return -EINVAL;
+  }
+
+  // Every counter is written by a single thread or atomically, so relaxed loads are enough
+
+  atomic_store_explicit(&snapshot->submissions, atomic_load_explicit(&ring->statistics.submissions,  memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->completions, atomic_load_explicit(&ring->statistics.completions,  memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->calls,       atomic_load_explicit(&ring->statistics.calls,        memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->overflows,   atomic_load_explicit(&ring->statistics.overflows,    memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->flushes,     atomic_load_explicit(&ring->statistics.flushes,      memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->depth,       atomic_load_explicit(&ring->statistics.depth,        memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->peak,        atomic_load_explicit(&ring->statistics.peak,         memory_order_relaxed), memory_order_relaxed);
+  atomic_store_explicit(&snapshot->allocated,   atomic_load_explicit(&ring->descriptors.allocated,   memory_order_relaxed), memory_order_relaxed);
+
+  // Caches are never removed from the list until the ring is released
+
+  cached = 0;
+
+  for (cache = atomic_load_explicit(&ring->descriptors.caches.top, memory_order_acquire); cache != NULL; cache = cache->next)
+  {
+    //
+    cached += atomic_load_explicit(&((struct FastRingDescriptorCache*)cache)->hits, memory_order_relaxed);
+  }
+
+  atomic_store_explicit(&snapshot->cached, cached, memory_order_relaxed);
+
+  for (opcode = 0; opcode < RING_STATISTICS_OPCODE_COUNT; ++ opcode)
+  {
+    for (index = 0; index < RING_STATISTICS_HISTOGRAM_LENGTH; ++ index)
+    {
+      //
+      atomic_store_explicit(&snapshot->histograms[opcode][index], atomic_load_explicit(&ring->statistics.histograms[opcode][index], memory_order_relaxed), memory_order_relaxed);
+    }
+  }
+
+  return 0;
+}
+
+uint64_t GetFastRingStatisticsBound(uint32_t index)
+{
+  if (index < (1U << RING_STATISTICS_HISTOGRAM_SHIFT))
+  {
+    //
+    return index;
+  }
+
+  return (uint64_t)((1U << RING_STATISTICS_HISTOGRAM_SHIFT) | (index & ((1U << RING_STATISTICS_HISTOGRAM_SHIFT) - 1))) << ((index >> RING_STATISTICS_HISTOGRAM_SHIFT) - 1);
+}
+#endif
+
 // Poll
 
-static int __attribute__((hot)) HandlePollEvent(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+static inline __attribute__((always_inline)) struct FastRingDescriptor* MakeRingPollEntry(struct FastRingDescriptor* descriptor)
+{
+  return (struct FastRingDescriptor*)ADD_ABA_TAG(descriptor, atomic_load_explicit(&descriptor->tag, memory_order_relaxed), RING_DESC_ALIGNMENT);
+}
+
+static inline __attribute__((always_inline)) struct FastRingDescriptor* GetRingPollDescriptor(struct FastRingFileEntry* entry, void** value)
+{
+  struct FastRingDescriptor* descriptor;
+  void* tagged;
+
+  // Entry keeps pointer and tag of descriptor in one word, descriptors are never unmapped while the ring exists,
+  // so a released (and probably reused) descriptor is safely detected by comparing the tags
+
+  tagged     = atomic_load_explicit(&entry->descriptor, memory_order_acquire);
+  descriptor = REMOVE_ABA_TAG(struct FastRingDescriptor, tagged, RING_DESC_ALIGNMENT);
+
+  if (value != NULL)
+  {
+    //
+    *value = tagged;
+  }
+
+  if (likely((descriptor != NULL) &&
+             (tagged == ADD_ABA_TAG(descriptor, atomic_load_explicit(&descriptor->tag, memory_order_acquire), RING_DESC_ALIGNMENT))))
+  {
+    //
+    return descriptor;
+  }
+
+  return NULL;
+}
+
+static inline __attribute__((always_inline)) uint64_t PrepareRingPollFlags(uint64_t flags)
+{
+  if (flags & RING_POLL_LEVEL)
+  {
+    // Level triggering is emulated over kernel multishot poll, which has to be re-armed once kernel terminates it
+    flags &= ~RING_POLL_SHOT;
+    flags |=  RING_POLL_REPEAT;
+  }
+
+  return flags;
+}
+
+static inline __attribute__((always_inline)) void QueueRingPollReadiness(struct FastRingDescriptor* descriptor)
 {
   struct FastRing* ring;
+
+  // Has to be called in the ring's thread, queue holds a reference to the descriptor
+
+  if ((atomic_load_explicit(&descriptor->data.poll.events, memory_order_relaxed) & ((uint32_t)descriptor->data.poll.flags | POLLERR | POLLHUP)) &&
+      ((atomic_fetch_or_explicit(&descriptor->data.poll.condition, RING_CONDITION_READY, memory_order_relaxed) & (RING_CONDITION_READY | RING_CONDITION_REMOVE)) == 0))
+  {
+    ring                       = descriptor->ring;
+    descriptor->data.poll.next = ring->files.ready;
+    ring->files.ready          = descriptor;
+    atomic_fetch_add_explicit(&descriptor->references, 1, memory_order_relaxed);
+  }
+}
+
+static void HandleRingPollReadiness(struct FastRing* ring)
+{
+  struct FastRingDescriptor* descriptor;
+  struct FastRingDescriptor* next;
+  struct pollfd probe;
+  uint32_t condition;
+  uint32_t events;
+
+  next              = ring->files.ready;
+  ring->files.ready = NULL;
+
+  while (descriptor = next)
+  {
+    next      = descriptor->data.poll.next;
+    condition = atomic_fetch_and_explicit(&descriptor->data.poll.condition, ~RING_CONDITION_READY, memory_order_acquire);
+    events    = atomic_load_explicit(&descriptor->data.poll.events, memory_order_relaxed) & ((uint32_t)descriptor->data.poll.flags | POLLERR | POLLHUP);
+    events   *= !(condition & RING_CONDITION_REMOVE);
+
+    if ((events != 0) &&
+        (descriptor->data.poll.flags & RING_POLL_PROBE))
+    {
+      // Consumer could drain the handle without telling, kernel knows better
+      probe.fd      = descriptor->data.poll.handle;
+      probe.events  = events;
+      probe.revents = 0;
+      events       &= (poll(&probe, 1, 0) > 0) * probe.revents;
+      atomic_fetch_and_explicit(&descriptor->data.poll.events, events, memory_order_relaxed);
+    }
+
+    if (events != 0)
+    {
+      descriptor->data.poll.function(descriptor->data.poll.handle, events, descriptor->closure, descriptor->data.poll.flags);
+      QueueRingPollReadiness(descriptor);
+    }
+
+    ReleaseFastRingDescriptor(descriptor);
+  }
+}
+
+static int __attribute__((hot)) HandlePollEvent(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
   uint32_t condition;
 
   if (likely(( completion      != NULL) &&
@@ -621,21 +1952,32 @@ static int __attribute__((hot)) HandlePollEvent(struct FastRingDescriptor* descr
               condition & RING_CONDITION_MASK | completion->flags & IORING_CQE_F_MORE | RING_CONDITION_GUARD,
               memory_order_release, memory_order_relaxed)));
 
+    if (descriptor->data.poll.flags & RING_POLL_LEVEL)
+    {
+      // Readiness is kept until it is cleared by consumer or probe
+      atomic_fetch_or_explicit(&descriptor->data.poll.events, completion->res, memory_order_relaxed);
+    }
+
     if (likely(~condition & RING_CONDITION_REMOVE))
     {
       //
       descriptor->data.poll.function(descriptor->data.poll.handle, completion->res, descriptor->closure, descriptor->data.poll.flags);
     }
 
+    if ((descriptor->data.poll.flags & RING_POLL_LEVEL) &&
+        (~condition & RING_CONDITION_REMOVE))
+    {
+      //
+      QueueRingPollReadiness(descriptor);
+    }
+
     if (unlikely(completion->flags & IORING_CQE_F_MORE))
     {
       atomic_fetch_and_explicit(&descriptor->data.poll.condition, ~RING_CONDITION_GUARD, memory_order_acq_rel);
       goto Final;
     }
 
-    ring = descriptor->ring;
-
-    pthread_mutex_lock(&ring->files.lock);
+    // Concurrent UpdateFastRingPoll() and RemoveFastRingPoll() are ordered by the condition and the state of descriptor
 
     if (likely((~atomic_fetch_and_explicit(&descriptor->data.poll.condition, ~RING_CONDITION_GUARD, memory_order_acq_rel) & RING_CONDITION_REMOVE) &&
                ( atomic_load_explicit(&descriptor->state, memory_order_relaxed) == RING_DESC_STATE_SUBMITTED)))
@@ -648,14 +1990,11 @@ static int __attribute__((hot)) HandlePollEvent(struct FastRingDescriptor* descr
         io_uring_prep_poll_add(&descriptor->submission, descriptor->data.poll.handle, descriptor->data.poll.flags);
         descriptor->submission.len = RING_POLL_FLAGS(descriptor->data.poll.flags);
         SubmitFastRingDescriptor(descriptor, 0);
-        pthread_mutex_unlock(&ring->files.lock);
         return 1;
       }
 
       atomic_fetch_or_explicit(&descriptor->data.poll.condition, RING_CONDITION_UPDATE, memory_order_relaxed);
     }
-
-    pthread_mutex_unlock(&ring->files.lock);
   }
 
   Final:
@@ -666,18 +2005,30 @@ static int __attribute__((hot)) HandlePollEvent(struct FastRingDescriptor* descr
 int AddFastRingPoll(struct FastRing* ring, int handle, uint64_t flags, HandleFastRingPollFunction function, void* closure)
 {
   struct FastRingDescriptor* descriptor;
+  struct FastRingFileEntry* entry;
+  void* value;
 
   if (likely((handle >= 0) &&
              (ring   != NULL)))
   {
-    pthread_mutex_lock(&ring->files.lock);
+    if (unlikely((entry = GetRingFileEntry(&ring->files, handle)) == NULL))
+    {
+      pthread_mutex_lock(&ring->files.lock);
+      entry = ExpandRingFileList(&ring->files, handle);
+      pthread_mutex_unlock(&ring->files.lock);
+    }
+
+    if (likely(entry != NULL) &&
+        unlikely(GetRingPollDescriptor(entry, &value) != NULL))
+    {
+      // Handle is already polled, the entry holds a live descriptor
+      return -EEXIST;
+    }
 
-    if (likely((handle < ring->files.length) ||
-               (ExpandRingFileList(&ring->files, handle) != NULL)) &&
-               (descriptor = AllocateFastRingDescriptor(ring, HandlePollEvent, closure)))
+    if (likely((entry != NULL) &&
+               (descriptor = AllocateFastRingDescriptor(ring, HandlePollEvent, closure))))
     {
-      ring->files.entries[handle].tag        = atomic_load_explicit(&descriptor->tag, memory_order_relaxed);
-      ring->files.entries[handle].descriptor = descriptor;
+      flags = PrepareRingPollFlags(flags);
 
       io_uring_initialize_sqe(&descriptor->submission);
       io_uring_prep_poll_add(&descriptor->submission, handle, flags);
@@ -685,15 +2036,25 @@ int AddFastRingPoll(struct FastRing* ring, int handle, uint64_t flags, HandleFas
       descriptor->data.poll.function = function;
       descriptor->data.poll.handle   = handle;
       descriptor->data.poll.flags    = flags;
+      descriptor->data.poll.next     = NULL;
       atomic_fetch_add_explicit(&descriptor->references, 1, memory_order_relaxed);
       atomic_store_explicit(&descriptor->data.poll.condition, 0, memory_order_relaxed);
-      SubmitFastRingDescriptor(descriptor, 0);
+      atomic_store_explicit(&descriptor->data.poll.events, 0, memory_order_relaxed);
 
-      pthread_mutex_unlock(&ring->files.lock);
+      // Descriptor has to be complete before it becomes visible to lock-free lookups,
+      // only one of concurrent callers replaces the empty (or outdated) entry and arms the poll
+
+      if (unlikely(!atomic_compare_exchange_strong_explicit(&entry->descriptor, (struct FastRingDescriptor**)&value, MakeRingPollEntry(descriptor), memory_order_acq_rel, memory_order_relaxed)))
+      {
+        // Descriptor has never been visible nor submitted, drop both references at once
+        atomic_store_explicit(&descriptor->references, 1, memory_order_relaxed);
+        ReleaseFastRingDescriptor(descriptor);
+        return -EEXIST;
+      }
+
+      SubmitFastRingDescriptor(descriptor, 0);
       return 0;
     }
-
-    pthread_mutex_unlock(&ring->files.lock);
   }
 
   return -ENOMEM;
@@ -702,76 +2063,71 @@ int AddFastRingPoll(struct FastRing* ring, int handle, uint64_t flags, HandleFas
 int UpdateFastRingPoll(struct FastRing* ring, int handle, uint64_t flags)
 {
   struct FastRingDescriptor* descriptor;
+  struct FastRingFileEntry* entry;
   uint32_t condition;
   int result;
 
   result = -EBADF;
 
   if (likely((handle >= 0) &&
-             (ring != NULL)))
+             (ring != NULL) &&
+             (entry = GetRingFileEntry(&ring->files, handle)) &&
+             (descriptor = GetRingPollDescriptor(entry, NULL))))
   {
-    pthread_mutex_lock(&ring->files.lock);
+    flags                       = PrepareRingPollFlags(flags);
+    descriptor->data.poll.flags = flags;
+    result                      = 0;
 
-    if (likely((handle < ring->files.length) &&
-               (descriptor = ring->files.entries[handle].descriptor) &&
-               (atomic_load_explicit(&descriptor->tag, memory_order_acquire) == ring->files.entries[handle].tag)))
-    {
-      descriptor->data.poll.flags = flags;
-      condition                   = atomic_load_explicit(&descriptor->data.poll.condition, memory_order_relaxed);
-      result                      = 0;
+    // Read-modify-write publishes new flags to HandlePollEvent() when it is going to re-arm the descriptor by itself
+    condition = atomic_fetch_or_explicit(&descriptor->data.poll.condition, 0, memory_order_acq_rel);
 
-      if (unlikely(LockPendingRingDescriptor(descriptor)))
+    if (unlikely(LockPendingRingDescriptor(descriptor)))
+    {
+      if (descriptor->submission.opcode == IORING_OP_POLL_ADD)
       {
-        if (descriptor->submission.opcode == IORING_OP_POLL_ADD)
-        {
-          descriptor->submission.poll32_events = __io_uring_prep_poll_mask(flags);
-          descriptor->submission.len           = RING_POLL_FLAGS(flags);
-          atomic_store_explicit(&descriptor->state, RING_DESC_STATE_PENDING, memory_order_release);
-          goto Final;
-        }
-
         descriptor->submission.poll32_events = __io_uring_prep_poll_mask(flags);
-        descriptor->submission.len           = IORING_POLL_UPDATE_USER_DATA | IORING_POLL_UPDATE_EVENTS;
+        descriptor->submission.len           = RING_POLL_FLAGS(flags);
         atomic_store_explicit(&descriptor->state, RING_DESC_STATE_PENDING, memory_order_release);
-        goto Final;
+        return result;
       }
 
-      if (( condition & RING_CONDITION_GUARD) &&
-          (~condition & IORING_CQE_F_MORE)    &&
-          ( flags     & RING_POLL_REPEAT))
-      {
-        //
-        goto Final;
-      }
+      descriptor->submission.poll32_events = __io_uring_prep_poll_mask(flags);
+      descriptor->submission.len           = IORING_POLL_UPDATE_USER_DATA | IORING_POLL_UPDATE_EVENTS;
+      atomic_store_explicit(&descriptor->state, RING_DESC_STATE_PENDING, memory_order_release);
+      return result;
+    }
 
-      if (unlikely(!LockSubmittedRingDescriptor(descriptor)))
-      {
-        result = -EBUSY * !(condition & RING_CONDITION_GUARD);
-        goto Final;
-      }
+    if (( condition & RING_CONDITION_GUARD) &&
+        (~condition & IORING_CQE_F_MORE)    &&
+        ( flags     & RING_POLL_REPEAT))
+    {
+      //
+      return result;
+    }
 
-      io_uring_initialize_sqe(&descriptor->submission);
+    if (unlikely(!LockSubmittedRingDescriptor(descriptor)))
+    {
+      //
+      return -EBUSY * !(condition & RING_CONDITION_GUARD);
+    }
 
-      if ((( condition & RING_CONDITION_GUARD) && (~condition & IORING_CQE_F_MORE))    ||
-          ((~condition & RING_CONDITION_GUARD) && ((condition & RING_CONDITION_UPDATE) ||
-          (atomic_load_explicit(&descriptor->references, memory_order_relaxed) == 1))))
-      {
-        io_uring_prep_poll_add(&descriptor->submission, handle, flags);
-        descriptor->submission.len = RING_POLL_FLAGS(flags);
-        atomic_fetch_and_explicit(&descriptor->data.poll.condition, ~RING_CONDITION_UPDATE, memory_order_relaxed);
-        atomic_fetch_add_explicit(&descriptor->references, 1, memory_order_relaxed);
-        SubmitFastRingDescriptor(descriptor, 0);
-        goto Final;
-      }
+    io_uring_initialize_sqe(&descriptor->submission);
 
-      io_uring_prep_poll_update(&descriptor->submission, descriptor->identifier, descriptor->identifier, flags, IORING_POLL_UPDATE_USER_DATA | IORING_POLL_UPDATE_EVENTS);
+    if ((( condition & RING_CONDITION_GUARD) && (~condition & IORING_CQE_F_MORE))    ||
+        ((~condition & RING_CONDITION_GUARD) && ((condition & RING_CONDITION_UPDATE) ||
+        (atomic_load_explicit(&descriptor->references, memory_order_relaxed) == 1))))
+    {
+      io_uring_prep_poll_add(&descriptor->submission, handle, flags);
+      descriptor->submission.len = RING_POLL_FLAGS(flags);
+      atomic_fetch_and_explicit(&descriptor->data.poll.condition, ~RING_CONDITION_UPDATE, memory_order_relaxed);
       atomic_fetch_add_explicit(&descriptor->references, 1, memory_order_relaxed);
-      SubmitFastRingDescriptor(descriptor, RING_DESC_OPTION_IGNORE);
+      SubmitFastRingDescriptor(descriptor, 0);
+      return result;
     }
 
-    Final:
-
-    pthread_mutex_unlock(&ring->files.lock);
+    io_uring_prep_poll_update(&descriptor->submission, descriptor->identifier, descriptor->identifier, flags, IORING_POLL_UPDATE_USER_DATA | IORING_POLL_UPDATE_EVENTS);
+    atomic_fetch_add_explicit(&descriptor->references, 1, memory_order_relaxed);
+    SubmitFastRingDescriptor(descriptor, RING_DESC_OPTION_IGNORE);
   }
 
   return result;
@@ -780,94 +2136,112 @@ int UpdateFastRingPoll(struct FastRing* ring, int handle, uint64_t flags)
 int RemoveFastRingPoll(struct FastRing* ring, int handle)
 {
   struct FastRingDescriptor* descriptor;
-  int result;
-
-  result = -EBADF;
+  struct FastRingFileEntry* entry;
+  void* value;
 
-  if (likely((handle >= 0) &&
-             (ring   != NULL)))
+  if (unlikely((handle < 0)   ||
+               (ring == NULL) ||
+               ((entry = GetRingFileEntry(&ring->files, handle)) == NULL) ||
+               ((descriptor = GetRingPollDescriptor(entry, &value)) == NULL) ||
+               (!atomic_compare_exchange_strong_explicit(&entry->descriptor, (struct FastRingDescriptor**)&value, NULL, memory_order_acq_rel, memory_order_relaxed))))
   {
-    pthread_mutex_lock(&ring->files.lock);
-
-    if (likely((handle < ring->files.length) &&
-               (descriptor = ring->files.entries[handle].descriptor) &&
-               (atomic_load_explicit(&descriptor->tag, memory_order_acquire) == ring->files.entries[handle].tag)))
-    {
-      atomic_fetch_or_explicit(&descriptor->data.poll.condition, RING_CONDITION_REMOVE, memory_order_relaxed);
-      ring->files.entries[handle].descriptor = NULL;
-      ring->files.entries[handle].tag        = 0;
-      result                                 = 0;
-
-      if (unlikely(LockPendingRingDescriptor(descriptor)))
-      {
-        if (descriptor->submission.opcode == IORING_OP_POLL_ADD)
-        {
-          io_uring_initialize_sqe(&descriptor->submission);
-          io_uring_prep_nop(&descriptor->submission);
-          PrepareFastRingDescriptor(descriptor, RING_DESC_OPTION_IGNORE);
-          ReleaseFastRingDescriptor(descriptor);
-          goto Final;
-        }
-
-        io_uring_initialize_sqe(&descriptor->submission);
-        io_uring_prep_poll_remove(&descriptor->submission, descriptor->identifier);
-        PrepareFastRingDescriptor(descriptor, RING_DESC_OPTION_IGNORE);
-        ReleaseFastRingDescriptor(descriptor);
-        goto Final;
-      }
+    // Only one of concurrent callers wins the entry and owns the removal
+    return -EBADF;
+  }
 
-      if (unlikely(!LockSubmittedRingDescriptor(descriptor)))
-      {
-        // Failure: drop the owner-reference last.
-        result = -EBADF;
-        ReleaseFastRingDescriptor(descriptor);
-        goto Final;
-      }
+  atomic_fetch_or_explicit(&descriptor->data.poll.condition, RING_CONDITION_REMOVE, memory_order_relaxed);
 
+  while (unlikely(!LockPendingRingDescriptor(descriptor)))
+  {
+    if (likely(LockSubmittedRingDescriptor(descriptor)))
+    {
       // Submitted: publish the cancel-reference first, then drop the owner-reference.
       io_uring_initialize_sqe(&descriptor->submission);
       io_uring_prep_poll_remove(&descriptor->submission, descriptor->identifier);
       atomic_fetch_add_explicit(&descriptor->references, 1, memory_order_relaxed);
       SubmitFastRingDescriptor(descriptor, RING_DESC_OPTION_IGNORE);
       ReleaseFastRingDescriptor(descriptor);
+      return 0;
+    }
+
+    if (atomic_load_explicit(&descriptor->state, memory_order_relaxed) != RING_DESC_STATE_PENDING)
+    {
+      // Failure: drop the owner-reference last.
+      ReleaseFastRingDescriptor(descriptor);
+      return -EBADF;
     }
 
-    Final:
+    // Descriptor was re-armed by concurrent update meanwhile, try again to take it pending
+  }
 
-    pthread_mutex_unlock(&ring->files.lock);
+  if (descriptor->submission.opcode == IORING_OP_POLL_ADD)
+  {
+    io_uring_initialize_sqe(&descriptor->submission);
+    io_uring_prep_nop(&descriptor->submission);
+    PrepareFastRingDescriptor(descriptor, RING_DESC_OPTION_IGNORE);
+    ReleaseFastRingDescriptor(descriptor);
+    return 0;
   }
 
-  return result;
+  io_uring_initialize_sqe(&descriptor->submission);
+  io_uring_prep_poll_remove(&descriptor->submission, descriptor->identifier);
+  PrepareFastRingDescriptor(descriptor, RING_DESC_OPTION_IGNORE);
+  ReleaseFastRingDescriptor(descriptor);
+  return 0;
+}
+
+int ClearFastRingPoll(struct FastRing* ring, int handle, uint32_t events)
+{
+  struct FastRingDescriptor* descriptor;
+  struct FastRingFileEntry* entry;
+
+  if (likely((handle >= 0) &&
+             (ring   != NULL) &&
+             (entry = GetRingFileEntry(&ring->files, handle)) &&
+             (descriptor = GetRingPollDescriptor(entry, NULL))))
+  {
+    // Readiness is gone (i.e. consumer got EAGAIN), the handle won't be delivered again until kernel reports it
+    atomic_fetch_and_explicit(&descriptor->data.poll.events, ~events, memory_order_relaxed);
+    return 0;
+  }
+
+  return -EBADF;
 }
 
 void DestroyFastRingPoll(struct FastRing* ring, HandleFastRingPollFunction function, void* closure)
 {
+  struct FastRingFileTable* table;
   struct FastRingFileEntry* entry;
   struct FastRingFileEntry* limit;
   struct FastRingDescriptor* descriptor;
+  uint32_t number;
 
-  if (likely(ring != NULL))
+  if (likely((ring != NULL) &&
+             (table = atomic_load_explicit(&ring->files.table, memory_order_acquire))))
   {
-    pthread_mutex_lock(&ring->files.lock);
-
-    entry = ring->files.entries;
-    limit = ring->files.entries + ring->files.length;
-
-    while (entry < limit)
+    for (number = 0; number < table->length; ++ number)
     {
-      if (unlikely((descriptor = entry->descriptor) &&
-                   (atomic_load_explicit(&descriptor->tag, memory_order_acquire) == entry->tag) &&
-                   (descriptor->data.poll.function == function) &&
-                   (descriptor->closure            == closure)))
+      if ((entry = atomic_load_explicit(table->pages + number, memory_order_acquire)) == NULL)
       {
-        // Remove handler and submit cancel request
-        RemoveFastRingPoll(ring, descriptor->data.poll.handle);
+        //
+        continue;
       }
 
-      entry ++;
-    }
+      limit = entry + FILE_LIST_INCREASE;
 
-    pthread_mutex_unlock(&ring->files.lock);
+      while (entry < limit)
+      {
+        if (unlikely((descriptor = GetRingPollDescriptor(entry, NULL)) &&
+                     (descriptor->data.poll.function == function) &&
+                     (descriptor->closure            == closure)))
+        {
+          // Remove handler and submit cancel request
+          RemoveFastRingPoll(ring, descriptor->data.poll.handle);
+        }
+
+        entry ++;
+      }
+    }
   }
 }
 
@@ -883,32 +2257,26 @@ int SetFastRingPoll(struct FastRing* ring, int handle, uint64_t flags, HandleFas
     AddFastRingPoll(ring, handle, flags, function, closure) :
     result;
 
+  result = (result == -EEXIST) ?
+    UpdateFastRingPoll(ring, handle, flags) :
+    result;
+
   return result;
 }
 
 struct FastRingDescriptor* GetFastRingPollDescriptor(struct FastRing* ring, int handle)
 {
-  struct FastRingDescriptor* descriptor;
-
-  descriptor = NULL;
+  struct FastRingFileEntry* entry;
 
   if (likely((handle >= 0) &&
-             (ring   != NULL)))
+             (ring   != NULL) &&
+             (entry = GetRingFileEntry(&ring->files, handle))))
   {
-    pthread_mutex_lock(&ring->files.lock);
-
-    if ((handle < ring->files.length) &&
-        (descriptor = ring->files.entries[handle].descriptor) &&
-        (atomic_load_explicit(&descriptor->tag, memory_order_acquire) != ring->files.entries[handle].tag))
-    {
-      // Existing descriptor could change purpose and ownership
-      descriptor = NULL;
-    }
-
-    pthread_mutex_unlock(&ring->files.lock);
+    // Existing descriptor could change purpose and ownership, tag validation drops such one
+    return GetRingPollDescriptor(entry, NULL);
   }
 
-  return descriptor;
+  return NULL;
 }
 
 // Watch
@@ -1251,88 +2619,409 @@ struct FastRingDescriptor* SetFastRingTimeout(struct FastRing* ring, struct Fast
     return NULL;
   }
 
-  if ((interval >= 0) &&
-      (descriptor != NULL))
+  if ((interval >= 0) &&
+      (descriptor != NULL))
+  {
+    descriptor->data.timeout.interval.tv_sec  =  interval / 1000;
+    descriptor->data.timeout.interval.tv_nsec = (interval % 1000) * 1000000;
+    UpdateTimeout(descriptor);
+    return descriptor;
+  }
+
+  if ((ring != NULL) &&
+      (interval >= 0) &&
+      (descriptor = AllocateFastRingDescriptor(ring, HandleTimeoutEvent, NULL)))
+  {
+    descriptor->data.timeout.interval.tv_sec  =  interval / 1000;
+    descriptor->data.timeout.interval.tv_nsec = (interval % 1000) * 1000000;
+    CreateTimeout(descriptor, function, closure, flags);
+    return descriptor;
+  }
+
+  return NULL;
+}
+
+struct FastRingDescriptor* SetFastRingCertainTimeout(struct FastRing* ring, struct FastRingDescriptor* descriptor, struct timeval* interval, uint64_t flags, HandleFastRingTimeoutFunction function, void* closure)
+{
+  if ((interval == NULL) &&
+      (descriptor != NULL))
+  {
+    RemoveTimeout(descriptor);
+    return NULL;
+  }
+
+  if ((interval != NULL) &&
+      (descriptor != NULL))
+  {
+    descriptor->data.timeout.interval.tv_sec  = interval->tv_sec;
+    descriptor->data.timeout.interval.tv_nsec = interval->tv_usec * 1000;
+    UpdateTimeout(descriptor);
+    return descriptor;
+  }
+
+  if ((ring != NULL) &&
+      (interval != NULL) &&
+      (descriptor = AllocateFastRingDescriptor(ring, HandleTimeoutEvent, NULL)))
+  {
+    descriptor->data.timeout.interval.tv_sec  = interval->tv_sec;
+    descriptor->data.timeout.interval.tv_nsec = interval->tv_usec * 1000;
+    CreateTimeout(descriptor, function, closure, flags);
+    return descriptor;
+  }
+
+  return NULL;
+}
+
+struct FastRingDescriptor* SetFastRingPreciseTimeout(struct FastRing* ring, struct FastRingDescriptor* descriptor, struct timespec* interval, uint64_t flags, HandleFastRingTimeoutFunction function, void* closure)
+{
+  if ((interval == NULL) &&
+      (descriptor != NULL))
+  {
+    RemoveTimeout(descriptor);
+    return NULL;
+  }
+
+  if ((interval != NULL) &&
+      (descriptor != NULL))
+  {
+    descriptor->data.timeout.interval.tv_sec  = interval->tv_sec;
+    descriptor->data.timeout.interval.tv_nsec = interval->tv_nsec;
+    UpdateTimeout(descriptor);
+    return descriptor;
+  }
+
+  if ((ring != NULL) &&
+      (interval != NULL) &&
+      (descriptor = AllocateFastRingDescriptor(ring, HandleTimeoutEvent, NULL)))
+  {
+    descriptor->data.timeout.interval.tv_sec  = interval->tv_sec;
+    descriptor->data.timeout.interval.tv_nsec = interval->tv_nsec;
+    CreateTimeout(descriptor, function, closure, flags);
+    return descriptor;
+  }
+
+  return NULL;
+}
+
+// Timer
+
+static inline __attribute__((always_inline)) uint64_t GetRingTimerTick()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000ULL + (uint64_t)time.tv_nsec / 1000000ULL;
+}
+
+static inline __attribute__((always_inline)) uint64_t ApplyRingTimerSlack(struct FastRingTimerWheel* wheel, struct FastRingTimer* timer)
+{
+  uint64_t limit;
+  uint64_t mask;
+  uint32_t slack;
+
+  slack = timer->slack ? timer->slack : wheel->slack;
+  slack = (timer->flags & RING_TIMER_FLAG_PRECISE) ? 0 : slack;
+  limit = timer->schedule + slack;
+  mask  = timer->schedule ^ limit;
+
+  if (mask == 0)
+  {
+    //
+    return timer->schedule;
+  }
+
+  // Take the tick with most trailing zero bits in [schedule, schedule + slack],
+  // timers with overlapping windows meet on the same tick and fire by one wake-up
+  mask = (1ULL << (63 - __builtin_clzll(mask))) - 1;
+  return limit & ~mask;
+}
+
+static inline __attribute__((always_inline)) uint64_t InsertRingTimer(struct FastRingTimerWheel* wheel, struct FastRingTimer* timer, uint64_t minimum)
+{
+  uint64_t target;
+  uint64_t delta;
+  uint32_t level;
+  uint32_t position;
+
+  // Timer lands on the lowest level which covers its distance, slot is taken from the bits of absolute tick,
+  // so the wheel can skip empty ticks without moving timers, returns the tick when timer is fired or cascaded
+  // (minimum is the next tick, or the current one when timers are cascaded right before its slot is fired)
+
+  target = (timer->expiration > minimum) ? timer->expiration : minimum;
+  delta  = target - wheel->current;
+
+  if (unlikely(delta >= RING_TIMER_RANGE))
+  {
+    // Timer will be cascaded on the top level until it comes into the range
+    target = wheel->current + RING_TIMER_RANGE - 1;
+    delta  = RING_TIMER_RANGE - 1;
+  }
+
+  level    = (delta != 0) ? ((63 - __builtin_clzll(delta)) / RING_TIMER_BITS) : 0;
+  position = level * RING_TIMER_SLOTS + ((target >> (level * RING_TIMER_BITS)) & (RING_TIMER_SLOTS - 1));
+
+  timer->position = position;
+  timer->previous = wheel->slots + position;
+  timer->next     = wheel->slots[position];
+
+  if (timer->next != NULL)
+  {
+    //
+    timer->next->previous = &timer->next;
+  }
+
+  wheel->slots[position]  = timer;
+  wheel->bitmaps[level]  |= 1ULL << (position & (RING_TIMER_SLOTS - 1));
+  wheel->count ++;
+
+  return (target >> (level * RING_TIMER_BITS)) << (level * RING_TIMER_BITS);
+}
+
+static inline __attribute__((always_inline)) void RemoveRingTimer(struct FastRingTimerWheel* wheel, struct FastRingTimer* timer)
+{
+  *timer->previous = timer->next;
+
+  if (timer->next != NULL)
+  {
+    //
+    timer->next->previous = timer->previous;
+  }
+
+  if (wheel->slots[timer->position] == NULL)
+  {
+    // Timer could be in a detached list of fired or cascaded slot, the bit is cleared already then
+    wheel->bitmaps[timer->position / RING_TIMER_SLOTS] &= ~(1ULL << (timer->position & (RING_TIMER_SLOTS - 1)));
+  }
+
+  timer->previous = NULL;
+  timer->next     = NULL;
+  wheel->count --;
+}
+
+static inline __attribute__((always_inline)) struct FastRingTimer* DetachRingTimerSlot(struct FastRingTimerWheel* wheel, uint32_t position, struct FastRingTimer** list)
+{
+  if (*list = wheel->slots[position])
+  {
+    (*list)->previous       = list;
+    wheel->slots[position]  = NULL;
+    wheel->bitmaps[position / RING_TIMER_SLOTS] &= ~(1ULL << (position & (RING_TIMER_SLOTS - 1)));
+  }
+
+  return *list;
+}
+
+static uint64_t GetRingTimerEvent(struct FastRingTimerWheel* wheel)
+{
+  uint64_t granule;
+  uint64_t bitmap;
+  uint64_t result;
+  uint64_t event;
+  uint32_t shift;
+  uint32_t level;
+  uint32_t index;
+
+  result = UINT64_MAX;
+
+  for (level = 0; level < RING_TIMER_LEVELS; ++ level)
+  {
+    if (bitmap = wheel->bitmaps[level])
+    {
+      // Rotate the bitmap to start from the slot next to the current one, distance is 1..RING_TIMER_SLOTS granules
+      shift   = level * RING_TIMER_BITS;
+      granule = wheel->current >> shift;
+      index   = (granule + 1) & (RING_TIMER_SLOTS - 1);
+      bitmap  = (bitmap >> index) | (bitmap << ((RING_TIMER_SLOTS - index) & (RING_TIMER_SLOTS - 1)));
+      event   = (granule + __builtin_ctzll(bitmap) + 1) << shift;
+      result  = (event < result) ? event : result;
+    }
+  }
+
+  return result;
+}
+
+static void AdvanceRingTimerWheel(struct FastRingTimerWheel* wheel, uint64_t tick)
+{
+  struct FastRingTimer* timer;
+  struct FastRingTimer* list;
+  uint64_t event;
+  uint32_t level;
+
+  while (wheel->current < tick)
+  {
+    if ((wheel->count == 0) ||
+        ((event = GetRingTimerEvent(wheel)) > tick))
+    {
+      // Nothing happens till the tick, empty ticks are skipped at once
+      wheel->current = tick;
+      break;
+    }
+
+    wheel->current = event;
+
+    for (level = RING_TIMER_LEVELS - 1; level > 0; -- level)
+    {
+      if ((event & ((1ULL << (level * RING_TIMER_BITS)) - 1)) == 0)
+      {
+        DetachRingTimerSlot(wheel, level * RING_TIMER_SLOTS + ((event >> (level * RING_TIMER_BITS)) & (RING_TIMER_SLOTS - 1)), &list);
+
+        while (timer = list)
+        {
+          RemoveRingTimer(wheel, timer);
+          InsertRingTimer(wheel, timer, event);
+        }
+      }
+    }
+
+    DetachRingTimerSlot(wheel, event & (RING_TIMER_SLOTS - 1), &list);
+
+    while (timer = list)
+    {
+      RemoveRingTimer(wheel, timer);
+
+      if (timer->flags & RING_TIMER_FLAG_REPEAT)
+      {
+        // Timer is re-armed before the call, so the handler can cancel it,
+        // next period is counted from the schedule, so slack doesn't accumulate (unless the ring stalled for whole period)
+        timer->schedule   = (timer->schedule + timer->interval > event) ? (timer->schedule + timer->interval) : (event + timer->interval);
+        timer->expiration = ApplyRingTimerSlack(wheel, timer);
+        InsertRingTimer(wheel, timer, event + 1);
+      }
+
+      timer->function(timer, timer->closure);
+    }
+  }
+}
+
+static void ScheduleRingTimerWheel(struct FastRing* ring, struct FastRingTimerWheel* wheel, uint64_t event);
+
+static void HandleRingTimerWheel(struct FastRingDescriptor* descriptor)
+{
+  struct FastRingTimerWheel* wheel;
+  struct FastRing* ring;
+  uint64_t tick;
+
+  ring  = (struct FastRing*)descriptor->closure;
+  wheel = ring->timers;
+  tick  = GetRingTimerTick();
+
+  // Descriptor of one-shot timeout is released right after the call
+
+  wheel->descriptor = NULL;
+  wheel->state      = RING_TIMER_STATE_ADVANCING;
+
+  AdvanceRingTimerWheel(wheel, tick);
+
+  wheel->state = RING_TIMER_STATE_IDLE;
+
+  if (wheel->count > 0)
+  {
+    //
+    ScheduleRingTimerWheel(ring, wheel, GetRingTimerEvent(wheel));
+  }
+}
+
+static void ScheduleRingTimerWheel(struct FastRing* ring, struct FastRingTimerWheel* wheel, uint64_t event)
+{
+  uint64_t tick;
+
+  // Kernel timeout is moved only when the wheel needs it earlier, late wake-ups just re-arm it
+
+  if ((wheel->state == RING_TIMER_STATE_IDLE) &&
+      ((wheel->descriptor == NULL) ||
+       (event < wheel->deadline)))
   {
-    descriptor->data.timeout.interval.tv_sec  =  interval / 1000;
-    descriptor->data.timeout.interval.tv_nsec = (interval % 1000) * 1000000;
-    UpdateTimeout(descriptor);
-    return descriptor;
+    tick              = GetRingTimerTick();
+    wheel->deadline   = event;
+    wheel->descriptor = SetFastRingTimeout(ring, wheel->descriptor, (event > tick) ? (event - tick) : 0, 0, HandleRingTimerWheel, ring);
   }
+}
 
-  if ((ring != NULL) &&
-      (interval >= 0) &&
-      (descriptor = AllocateFastRingDescriptor(ring, HandleTimeoutEvent, NULL)))
+static inline __attribute__((always_inline)) struct FastRingTimerWheel* GetRingTimerWheel(struct FastRing* ring)
+{
+  if (unlikely(ring->timers == NULL))
   {
-    descriptor->data.timeout.interval.tv_sec  =  interval / 1000;
-    descriptor->data.timeout.interval.tv_nsec = (interval % 1000) * 1000000;
-    CreateTimeout(descriptor, function, closure, flags);
-    return descriptor;
+    // Wheel is allocated on first use
+    ring->timers = (struct FastRingTimerWheel*)calloc(1, sizeof(struct FastRingTimerWheel));
   }
 
-  return NULL;
+  return ring->timers;
 }
 
-struct FastRingDescriptor* SetFastRingCertainTimeout(struct FastRing* ring, struct FastRingDescriptor* descriptor, struct timeval* interval, uint64_t flags, HandleFastRingTimeoutFunction function, void* closure)
+int SetFastRingTimer(struct FastRing* ring, struct FastRingTimer* timer, uint32_t interval, uint32_t flags, HandleFastRingTimerFunction function, void* closure)
 {
-  if ((interval == NULL) &&
-      (descriptor != NULL))
+  struct FastRingTimerWheel* wheel;
+  uint64_t tick;
+
+  if (unlikely((ring     == NULL) ||
+               (timer    == NULL) ||
+               (function == NULL)))
   {
-    RemoveTimeout(descriptor);
-    return NULL;
+    //
+    return -EINVAL;
   }
 
-  if ((interval != NULL) &&
-      (descriptor != NULL))
+  if (unlikely((wheel = GetRingTimerWheel(ring)) == NULL))
   {
-    descriptor->data.timeout.interval.tv_sec  = interval->tv_sec;
-    descriptor->data.timeout.interval.tv_nsec = interval->tv_usec * 1000;
-    UpdateTimeout(descriptor);
-    return descriptor;
+    //
+    return -ENOMEM;
   }
 
-  if ((ring != NULL) &&
-      (interval != NULL) &&
-      (descriptor = AllocateFastRingDescriptor(ring, HandleTimeoutEvent, NULL)))
+  if (timer->previous != NULL)
   {
-    descriptor->data.timeout.interval.tv_sec  = interval->tv_sec;
-    descriptor->data.timeout.interval.tv_nsec = interval->tv_usec * 1000;
-    CreateTimeout(descriptor, function, closure, flags);
-    return descriptor;
+    // Re-arming
+    RemoveRingTimer(wheel, timer);
   }
 
-  return NULL;
+  tick = GetRingTimerTick();
+
+  if (wheel->count == 0)
+  {
+    // Wheel is not driven while it is empty
+    wheel->current = (wheel->current > tick) ? wheel->current : tick;
+  }
+
+  timer->schedule   = tick + interval;
+  timer->interval   = interval;
+  timer->flags      = flags;
+  timer->function   = function;
+  timer->closure    = closure;
+  timer->expiration = ApplyRingTimerSlack(wheel, timer);
+
+  ScheduleRingTimerWheel(ring, wheel, InsertRingTimer(wheel, timer, wheel->current + 1));
+  return 0;
 }
 
-struct FastRingDescriptor* SetFastRingPreciseTimeout(struct FastRing* ring, struct FastRingDescriptor* descriptor, struct timespec* interval, uint64_t flags, HandleFastRingTimeoutFunction function, void* closure)
+void CancelFastRingTimer(struct FastRing* ring, struct FastRingTimer* timer)
 {
-  if ((interval == NULL) &&
-      (descriptor != NULL))
+  if (likely((ring            != NULL) &&
+             (ring->timers    != NULL) &&
+             (timer           != NULL) &&
+             (timer->previous != NULL)))
   {
-    RemoveTimeout(descriptor);
-    return NULL;
+    // Kernel timeout is left as is, it finds nothing to do or re-arms for the next timer
+    RemoveRingTimer(ring->timers, timer);
   }
+}
 
-  if ((interval != NULL) &&
-      (descriptor != NULL))
+int SetFastRingTimerSlack(struct FastRing* ring, uint32_t slack)
+{
+  struct FastRingTimerWheel* wheel;
+
+  if (unlikely(ring == NULL))
   {
-    descriptor->data.timeout.interval.tv_sec  = interval->tv_sec;
-    descriptor->data.timeout.interval.tv_nsec = interval->tv_nsec;
-    UpdateTimeout(descriptor);
-    return descriptor;
+    //
+    return -EINVAL;
   }
 
-  if ((ring != NULL) &&
-      (interval != NULL) &&
-      (descriptor = AllocateFastRingDescriptor(ring, HandleTimeoutEvent, NULL)))
+  if (unlikely((wheel = GetRingTimerWheel(ring)) == NULL))
   {
-    descriptor->data.timeout.interval.tv_sec  = interval->tv_sec;
-    descriptor->data.timeout.interval.tv_nsec = interval->tv_nsec;
-    CreateTimeout(descriptor, function, closure, flags);
-    return descriptor;
+    //
+    return -ENOMEM;
   }
 
-  return NULL;
+  // Applied to timers armed after the call
+  wheel->slack = slack;
+  return 0;
 }
 
 // Event
@@ -1367,19 +3056,181 @@ int SubmitFastRingEvent(struct FastRing* ring, struct FastRingDescriptor* event,
 
 // Buffer Provider
 
+static inline __attribute__((always_inline)) void PostRingBuffer(struct FastRingBufferProvider* provider, uint16_t index)
+{
+  uint16_t tail;
+  struct io_uring_buf* buffer;
+
+  tail  = atomic_load_explicit((_Atomic __u16*)&provider->data->tail, memory_order_relaxed);
+  tail &= provider->registration.ring_entries - 1;
+
+  buffer       = provider->data->bufs + tail;
+  buffer->addr = provider->map[index];
+  buffer->len  = provider->length;
+  buffer->bid  = index;
+
+  atomic_fetch_add_explicit((_Atomic __u16*)&provider->data->tail, 1, memory_order_release);
+}
+
+static void FillRingBufferProvider(struct FastRingBufferProvider* provider)
+{
+  uint16_t index;
+  uintptr_t address;
+
+  // Ring has room for all ids, so count of posted buffers never exceeds its capacity
+
+  while ((provider->statistics.count < provider->statistics.target) &&
+         (provider->spare > 0))
+  {
+    index = provider->spares[provider->spare - 1];
+
+    if (unlikely((address = (uintptr_t)provider->function(provider->length, provider->closure)) == 0))
+    {
+      // Allocation failed, next shortage will try again
+      break;
+    }
+
+    provider->spare --;
+    provider->map[index] = address;
+    provider->statistics.count ++;
+
+    PostRingBuffer(provider, index);
+  }
+
+  provider->statistics.peak = (provider->statistics.count > provider->statistics.peak) ? provider->statistics.count : provider->statistics.peak;
+}
+
+static void GrowRingBufferProvider(struct FastRingBufferProvider* provider)
+{
+  uint32_t target;
+  uint32_t capacity;
+  uint32_t count;
+
+  // Every receive armed at the moment of shortage reports -ENOBUFS, so the target grows once per refill:
+  // the next growth waits until buffers posted by the previous one are consumed
+
+  if (provider->statistics.consumed < provider->marks[2])
+  {
+    //
+    return;
+  }
+
+  capacity = provider->registration.ring_entries;
+  target   = provider->statistics.target;
+  count    = provider->statistics.count;
+  target  += target / 2 + 1;
+  target   = (target < capacity) ? target : capacity;
+
+  provider->statistics.grown += target - provider->statistics.target;
+  provider->statistics.target = target;
+
+  FillRingBufferProvider(provider);
+
+  provider->marks[2] = provider->statistics.consumed + provider->statistics.count - count;
+}
+
+static void ReclaimRingBufferProvider(struct FastRingBufferProvider* provider)
+{
+  uint16_t tail;
+  uint16_t index;
+  uint32_t number;
+  int available;
+  int result;
+
+  // Surplus is withdrawn from the tail of the ring, far from the head where the kernel takes buffers.
+  // Kernel updates the head under the ring's lock, so a second look at it (requires kernel 6.8) tells
+  // whether a concurrent receive reached the withdrawn entries, in that case the tail is put back.
+  // The second look only sees committed buffers: an issue on the ring thread selects and commits before it
+  // returns to user space and io-wq commits at selection, but the SQ thread of SQPOLL may keep a selected
+  // buffer uncommitted while this code runs, so there surplus is only left to consumers (see AdvanceFastRingBuffer)
+
+  if ((provider->release == NULL) ||
+      (provider->ring->parameters.flags & IORING_SETUP_SQPOLL) ||
+      (provider->statistics.count <= provider->statistics.target) ||
+      ((available = GetFastRingBufferAvailability(provider)) <= (int)provider->statistics.target))
+  {
+    //
+    return;
+  }
+
+  number = provider->statistics.count - provider->statistics.target;
+  result = available - provider->statistics.target;
+  number = (number < result) ? number : result;
+  tail   = atomic_load_explicit((_Atomic __u16*)&provider->data->tail, memory_order_relaxed);
+
+  atomic_store_explicit((_Atomic __u16*)&provider->data->tail, (uint16_t)(tail - number), memory_order_release);
+
+  if (unlikely(((result = GetFastRingBufferAvailability(provider)) < 0) ||
+               (result > available)))
+  {
+    // Head went past the new tail
+    atomic_store_explicit((_Atomic __u16*)&provider->data->tail, tail, memory_order_release);
+    return;
+  }
+
+  while (number > 0)
+  {
+    tail   --;
+    number --;
+    index  = provider->data->bufs[tail & (provider->registration.ring_entries - 1)].bid;
+
+    provider->release((void*)provider->map[index]);
+
+    provider->map[index]                 = 0;
+    provider->offsets[index]             = 0;
+    provider->spares[provider->spare ++] = index;
+    provider->statistics.count --;
+    provider->statistics.reclaimed ++;
+  }
+}
+
+static void HandleRingBufferTimer(struct FastRingTimer* timer, void* closure)
+{
+  struct FastRingBufferProvider* provider;
+  uint32_t target;
+
+  provider = (struct FastRingBufferProvider*)closure;
+  target   = provider->statistics.target;
+
+  if ((provider->statistics.shortages == provider->marks[1]) &&
+      ((provider->statistics.consumed - provider->marks[0]) < target))
+  {
+    // Less than one turnover of buffers within the window without shortages, shrink by a quarter,
+    // surplus buffers are not replaced when consumers take them and posted ones are reclaimed
+    target -= target / 4;
+    target  = (target > provider->statistics.minimum) ? target : provider->statistics.minimum;
+
+    provider->statistics.target = target;
+  }
+
+  provider->marks[0] = provider->statistics.consumed;
+  provider->marks[1] = provider->statistics.shortages;
+
+  ReclaimRingBufferProvider(provider);
+}
+
 struct FastRingBufferProvider* CreateFastRingBufferProvider(struct FastRing* ring, uint16_t group, uint16_t count, uint32_t length, CreateRingBufferFunction function, void* closure)
+{
+  return CreateFastRingBufferProviderEx(ring, group, count, length, 0, function, NULL, closure);
+}
+
+struct FastRingBufferProvider* CreateFastRingBufferProviderEx(struct FastRing* ring, uint16_t group, uint16_t count, uint32_t length, uint32_t flags, CreateRingBufferFunction function, ReleaseRingBufferFunction release, void* closure)
 {
   size_t alignment;
-  struct io_uring_buf* buffer;
+  uint32_t number;
+  uint32_t capacity;
   struct io_uring_buf_ring* data;
   struct FastRingBufferProvider* provider;
 
   alignment  = getpagesize();
-  count     += (count == 0) * ring->ring.cq.ring_entries;     // By default use count of CQE
-  count      = 1 << (32 - __builtin_clz(count - 1));          // Rounding up to next power of 2
-  group      = group ? group : GetFastRingBufferGroup(ring);  // Group number can be predefined
-  provider   = (struct FastRingBufferProvider*)calloc(1, sizeof(struct FastRingBufferProvider) + count * sizeof(uintptr_t));
-  data       = (struct io_uring_buf_ring*)memalign(alignment, sizeof(struct io_uring_buf_ring) + count * sizeof(struct io_uring_buf));
+  number     = count + (count == 0) * ring->ring.cq.ring_entries;  // By default use count of CQE
+  number     = 1 << (32 - __builtin_clz(number - 1));              // Rounding up to next power of 2
+  number     = (number < RING_BUFFER_MAXIMUM_COUNT) ? number : RING_BUFFER_MAXIMUM_COUNT;
+  capacity   = number * ((flags & RING_BUFFER_FLAG_ADAPTIVE) ? RING_BUFFER_ADAPTIVE_RATIO : 1);
+  capacity   = (capacity < RING_BUFFER_MAXIMUM_COUNT) ? capacity : RING_BUFFER_MAXIMUM_COUNT;
+  group      = group ? group : GetFastRingBufferGroup(ring);       // Group number can be predefined
+  provider   = (struct FastRingBufferProvider*)calloc(1, sizeof(struct FastRingBufferProvider) + capacity * (sizeof(uintptr_t) + sizeof(uint32_t) + sizeof(uint16_t)));
+  data       = (struct io_uring_buf_ring*)memalign(alignment, sizeof(struct io_uring_buf_ring) + capacity * sizeof(struct io_uring_buf));
 
   if ((data     == NULL) ||
       (provider == NULL))
@@ -1389,16 +3240,39 @@ struct FastRingBufferProvider* CreateFastRingBufferProvider(struct FastRing* rin
     return NULL;
   }
 
-  provider->ring   = ring;
-  provider->data   = data;
-  provider->length = length;
+  provider->ring     = ring;
+  provider->data     = data;
+  provider->length   = length;
+  provider->flags    = flags;
+  provider->function = function;
+  provider->release  = release;
+  provider->closure  = closure;
+  provider->offsets  = (uint32_t*)(provider->map + capacity);
+  provider->spares   = (uint16_t*)(provider->offsets + capacity);
+
+  // Adaptive provider registers the ring of maximal size once and keeps only target count of buffers in it
 
   provider->registration.ring_addr    = (uintptr_t)data;
-  provider->registration.ring_entries = count;
+  provider->registration.ring_entries = capacity;
   provider->registration.bgid         = group;
 
   io_uring_buf_ring_init(provider->data);
 
+  if (flags & RING_BUFFER_FLAG_INCREMENTAL)
+  {
+    RING_BUFFER_REGISTRATION_FLAGS(provider->registration) = IOU_PBUF_RING_INC;
+
+    if (io_uring_register_buf_ring(&ring->ring, &provider->registration, 0) == 0)
+    {
+      //
+      goto Continue;
+    }
+
+    // Kernel before 6.12 has no incremental consumption, fall back to whole buffers
+    RING_BUFFER_REGISTRATION_FLAGS(provider->registration) = 0;
+    provider->flags &= ~RING_BUFFER_FLAG_INCREMENTAL;
+  }
+
   if (io_uring_register_buf_ring(&ring->ring, &provider->registration, 0) != 0)
   {
     free(data);
@@ -1406,175 +3280,513 @@ struct FastRingBufferProvider* CreateFastRingBufferProvider(struct FastRing* rin
     return NULL;
   }
 
-  while (count > 0)
+  Continue:
+
+  while (capacity > 0)
+  {
+    // Lowest ids are taken first
+    provider->spares[provider->spare ++] = -- capacity;
+  }
+
+  provider->statistics.target  = number;
+  provider->statistics.minimum = number;
+
+  FillRingBufferProvider(provider);
+
+  if (flags & RING_BUFFER_FLAG_ADAPTIVE)
+  {
+    // Shrinking is driven by the ring's timer, so an idle provider gives its buffers back as well
+    SetFastRingTimer(ring, &provider->timer, RING_BUFFER_ADAPTIVE_WINDOW, RING_TIMER_FLAG_REPEAT, HandleRingBufferTimer, provider);
+  }
+
+  return provider;
+}
+
+void ReleaseFastRingBufferProvider(struct FastRingBufferProvider* provider, ReleaseRingBufferFunction function)
+{
+  if (provider != NULL)
+  {
+    CancelFastRingTimer(provider->ring, &provider->timer);
+    io_uring_unregister_buf_ring(&provider->ring->ring, provider->registration.bgid);
+
+    while ((function != NULL) && (provider->registration.ring_entries > 0))
+    {
+      provider->registration.ring_entries --;
+
+      if (provider->map[provider->registration.ring_entries] != 0)
+      {
+        // Ids on the stack of spares have no buffers
+        function((void*)provider->map[provider->registration.ring_entries]);
+      }
+    }
+
+    free(provider->data);
+    free(provider);
+  }
+}
+
+void PrepareFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_sqe* submission)
+{
+  submission->flags     |= IOSQE_BUFFER_SELECT;
+  submission->buf_group  = provider->registration.bgid;
+}
+
+uint8_t* GetFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_cqe* completion)
+{
+  return
+    likely((completion != NULL) && (completion->flags & IORING_CQE_F_BUFFER)) ?
+    (uint8_t*)provider->map[completion->flags >> IORING_CQE_BUFFER_SHIFT] + provider->offsets[completion->flags >> IORING_CQE_BUFFER_SHIFT] :
+    NULL;
+}
+
+void AdvanceFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_cqe* completion, CreateRingBufferFunction function, void* closure)
+{
+  uint16_t index;
+
+  if (unlikely(completion == NULL))
+  {
+    //
+    return;
+  }
+
+  provider->statistics.shortages += (completion->res == -ENOBUFS);
+
+  if (likely(completion->flags & IORING_CQE_F_BUFFER))
+  {
+    index = completion->flags >> IORING_CQE_BUFFER_SHIFT;
+
+    if (completion->flags & IORING_CQE_F_BUF_MORE)
+    {
+      // Kernel keeps the rest of the buffer, the next completion with the same id continues after this one
+      provider->offsets[index] += completion->res;
+      return;
+    }
+
+    provider->offsets[index] = 0;
+    provider->statistics.consumed ++;
+
+    if (unlikely((function != NULL) &&
+                 (provider->statistics.count > provider->statistics.target)))
+    {
+      // Consumer owns the buffer, just don't replace it
+      provider->map[index]                 = 0;
+      provider->spares[provider->spare ++] = index;
+      provider->statistics.count --;
+      provider->statistics.shrunk ++;
+      goto Continue;
+    }
+
+    if (likely(function != NULL))
+    {
+      // Replace existing buffer with new supplied
+      provider->map[index] = (uintptr_t)function(provider->length, closure);
+    }
+
+    PostRingBuffer(provider, index);
+  }
+
+  Continue:
+
+  if (unlikely((completion->res == -ENOBUFS) &&
+               (provider->flags & RING_BUFFER_FLAG_ADAPTIVE)))
+  {
+    //
+    GrowRingBufferProvider(provider);
+  }
+}
+
+int GetFastRingBufferAvailability(struct FastRingBufferProvider* provider)
+{
+  uint16_t head;
+  int result;
+
+  // Count of buffers the kernel can take right now, requires kernel 6.8 (IORING_REGISTER_PBUF_STATUS)
+
+  if (unlikely((result = io_uring_buf_ring_head(&provider->ring->ring, provider->registration.bgid, &head)) < 0))
+  {
+    //
+    return result;
+  }
+
+  return (uint16_t)(atomic_load_explicit((_Atomic __u16*)&provider->data->tail, memory_order_acquire) - head);
+}
+
+// Registered File
+
+static uint64_t* GetRingFileFilter(struct FastRing* ring, uint64_t** levels, uint32_t* lengths)
+{
+  uint32_t level;
+
+  // Upper part is reserved for allocation by kernel (IORING_FILE_INDEX_ALLOC), a half will be enough,
+  // level 0 has a bit per slot, every next level has a bit per full word of the previous one
+
+  lengths[0] = (ring->limit / 2 + 63) / 64;
+
+  for (level = 1; level < FILE_FILTER_LEVELS; ++ level)
+  {
+    //
+    lengths[level] = (lengths[level - 1] + 63) / 64;
+  }
+
+  if (unlikely((ring->files.filters == NULL) &&
+               ((ring->files.filters = (uint64_t*)calloc(lengths[0] + lengths[1] + lengths[2], sizeof(uint64_t))) == NULL)))
+  {
+    //
+    return NULL;
+  }
+
+  levels[0] = ring->files.filters;
+  levels[1] = levels[0] + lengths[0];
+  levels[2] = levels[1] + lengths[1];
+
+  return ring->files.filters;
+}
+
+static inline __attribute__((always_inline)) void MarkRingFileIndex(uint64_t** levels, uint32_t index)
+{
+  uint32_t level;
+
+  for (level = 0; level < FILE_FILTER_LEVELS; ++ level)
   {
-    provider->map[-- count] = (uintptr_t)function(length, closure);
+    levels[level][index / 64] |= 1ULL << (index % 64);
+
+    if (levels[level][index / 64] != UINT64_MAX)
+    {
+      // Word still has free slots, upper levels are not affected
+      break;
+    }
 
-    buffer       = provider->data->bufs + count;
-    buffer->addr = provider->map[count];
-    buffer->len  = length;
-    buffer->bid  = count;
+    index /= 64;
   }
-
-  atomic_store_explicit((_Atomic __u16*)&data->tail, provider->registration.ring_entries, memory_order_release);
-
-  return provider;
 }
 
-void ReleaseFastRingBufferProvider(struct FastRingBufferProvider* provider, ReleaseRingBufferFunction function)
+static inline __attribute__((always_inline)) void ClearRingFileIndex(uint64_t** levels, uint32_t index)
 {
-  if (provider != NULL)
+  uint32_t level;
+  uint64_t word;
+
+  for (level = 0; level < FILE_FILTER_LEVELS; ++ level)
   {
-    io_uring_unregister_buf_ring(&provider->ring->ring, provider->registration.bgid);
+    word                       = levels[level][index / 64];
+    levels[level][index / 64] &= ~(1ULL << (index % 64));
 
-    while ((function != NULL) && (provider->registration.ring_entries > 0))
+    if (word != UINT64_MAX)
     {
-      provider->registration.ring_entries --;
-      function((void*)provider->map[provider->registration.ring_entries]);
+      // Word was not full, upper levels are not affected
+      break;
     }
 
-    free(provider->data);
-    free(provider);
+    index /= 64;
   }
 }
 
-void PrepareFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_sqe* submission)
+static inline __attribute__((always_inline)) int AllocateRingFileIndex(uint64_t** levels, uint32_t* lengths, uint32_t limit)
 {
-  submission->flags     |= IOSQE_BUFFER_SELECT;
-  submission->buf_group  = provider->registration.bgid;
-}
+  uint32_t position;
+  uint32_t level;
 
-uint8_t* GetFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_cqe* completion)
-{
-  return
-    likely((completion != NULL) && (completion->flags & IORING_CQE_F_BUFFER)) ?
-    (uint8_t*)provider->map[completion->flags >> IORING_CQE_BUFFER_SHIFT] :
-    NULL;
-}
+  // Top level has FILE_MAXIMUM_COUNT / 2^19 words at most, every other level takes one word,
+  // so the lowest free slot is found in constant time
 
-void AdvanceFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_cqe* completion, CreateRingBufferFunction function, void* closure)
-{
-  uint16_t tail;
-  uint16_t index;
-  struct io_uring_buf* buffer;
+  position = 0;
+  level    = FILE_FILTER_LEVELS - 1;
 
-  if (likely((completion != NULL) &&
-             (completion->flags & IORING_CQE_F_BUFFER)))
+  while ((position < lengths[level]) &&
+         (levels[level][position] == UINT64_MAX))
+    position ++;
+
+  while (position < lengths[level])
   {
-    index = completion->flags >> IORING_CQE_BUFFER_SHIFT;
+    position = position * 64 + __builtin_ctzll(~levels[level][position]);
 
-    if (likely(function != NULL))
+    if (level == 0)
     {
-      // Replace existing buffer with new supplied
-      provider->map[index] = (uintptr_t)function(provider->length, closure);
+      // Bits over the limit are never set, so they look like free slots
+      return (position < limit) ? position : -EOVERFLOW;
     }
 
-    tail  = atomic_load_explicit((_Atomic __u16*)&provider->data->tail, memory_order_relaxed);
-    tail &= provider->registration.ring_entries - 1;
-
-    buffer       = provider->data->bufs + tail;
-    buffer->addr = provider->map[index];
-    buffer->len  = provider->length;
-    buffer->bid  = index;
-
-    atomic_fetch_add_explicit((_Atomic __u16*)&provider->data->tail, 1, memory_order_release);
+    level --;
   }
-}
 
-// Registered File
+  return -EOVERFLOW;
+}
 
-int AddFastRingRegisteredFile(struct FastRing* ring, int handle)
+static int UpdateRingRegisteredFiles(struct FastRing* ring, uint32_t index, int* handles, uint32_t count)
 {
   int result;
-  uint32_t limit;
-  uint32_t index;
+
+  result = (count > 0) ? io_uring_register_files_update(&ring->ring, index, handles, count) : 0;
+  return (result >= 0) ? 0 : result;
+}
+
+int AddFastRingRegisteredFileList(struct FastRing* ring, int* handles, int* indexes, uint32_t count)
+{
   struct FastRingFileEntry* entry;
+  uint64_t* levels[FILE_FILTER_LEVELS];
+  uint32_t lengths[FILE_FILTER_LEVELS];
+  uint32_t positions[FILE_UPDATE_BATCH_LENGTH];
+  int vector[FILE_UPDATE_BATCH_LENGTH];
+  uint32_t number;
+  uint32_t length;
+  uint32_t first;
+  int result;
+  int index;
 
-  result = -EBADF;
+  if (unlikely((ring    == NULL) ||
+               (handles == NULL) ||
+               (indexes == NULL)))
+  {
+    //
+    return -EINVAL;
+  }
 
-  if (likely((handle >= 0) &&
-             (ring   != NULL)))
+  pthread_mutex_lock(&ring->files.lock);
+
+  if (unlikely(GetRingFileFilter(ring, levels, lengths) == NULL))
   {
-    pthread_mutex_lock(&ring->files.lock);
+    pthread_mutex_unlock(&ring->files.lock);
+    return -ENOMEM;
+  }
 
-    if (likely((handle < ring->files.length) ||
-               (ExpandRingFileList(&ring->files, handle) != NULL)))
-    {
-      entry = ring->files.entries + handle;
+  first  = 0;
+  length = 0;
+  result = 0;
 
-      if (likely(entry->references > 0))
-      {
-        entry->references ++;
-        pthread_mutex_unlock(&ring->files.lock);
-        return entry->index;
-      }
+  // New slots are taken lowest first, so they mostly form contiguous runs and every run
+  // is registered by a single io_uring_register_files_update()
 
-      index = 0;
-      limit = ring->limit / 2;
+  for (number = 0; number <= count; ++ number)
+  {
+    entry = NULL;
+    index = -EBADF;
 
-      if (unlikely(ring->files.filters == NULL))
-      {
-        // Upper part is reserved for allocation by kernel, a half will be enough
-        ring->files.filters = (uint32_t*)calloc((limit >> 5) + 1, sizeof(uint32_t));
+    if ((number < count) &&
+        (handles[number] >= 0) &&
+        (entry = ExpandRingFileList(&ring->files, handles[number])) &&
+        (entry->references == 0))
+    {
+      //
+      index = AllocateRingFileIndex(levels, lengths, ring->limit / 2);
+    }
 
-        if (unlikely(ring->files.filters == NULL))
+    if ((length > 0) &&
+        ((number == count) ||
+         (length == FILE_UPDATE_BATCH_LENGTH) ||
+         (index  >= 0) && (index != first + length) ||
+         (entry  != NULL) && (entry->references > 0) && (entry->index - first < length)))
+    {
+      if (unlikely((result = UpdateRingRegisteredFiles(ring, first, vector, length)) < 0))
+      {
+        while (length > 0)
         {
-          pthread_mutex_unlock(&ring->files.lock);
-          return -ENOMEM;
+          length --;
+          entry                      = GetRingFileEntry(&ring->files, vector[length]);
+          entry->references          = 0;
+          indexes[positions[length]] = result;
+          ClearRingFileIndex(levels, first + length);
         }
+
+        entry = (number < count) ? GetRingFileEntry(&ring->files, handles[number]) : NULL;
+        index = ((entry != NULL) && (entry->references == 0) && (index < 0)) ? result : index;
       }
 
-      while ((index < limit) &&
-             (ring->files.filters[index >> 5] == UINT32_MAX))
-        index += 32;
+      length = 0;
+    }
 
-      index += __builtin_ffs(~ring->files.filters[index >> 5]) - 1;
+    if (number == count)
+    {
+      //
+      break;
+    }
 
-      if (unlikely(index >= limit))
-      {
-        // All registered files are already in use
-        pthread_mutex_unlock(&ring->files.lock);
-        return -EOVERFLOW;
-      }
+    if (unlikely(entry == NULL))
+    {
+      indexes[number] = -ENOMEM * (handles[number] >= 0) - EBADF * (handles[number] < 0);
+      continue;
+    }
 
-      result = io_uring_register_files_update(&ring->ring, index, &handle, 1);
+    if (entry->references > 0)
+    {
+      entry->references ++;
+      indexes[number] = entry->index;
+      continue;
+    }
 
-      if (likely(result >= 0))
-      {
-        ring->files.filters[index >> 5] |= 1 << (index & 31);
-        result             = index;
-        entry->index       = index;
-        entry->references ++;
-      }
+    if (unlikely(index < 0))
+    {
+      // All registered files are already in use
+      indexes[number] = index;
+      continue;
     }
 
-    pthread_mutex_unlock(&ring->files.lock);
+    MarkRingFileIndex(levels, index);
+
+    first             = (length == 0) ? index : first;
+    vector[length]    = handles[number];
+    positions[length] = number;
+    entry->index      = index;
+    entry->references = 1;
+    indexes[number]   = index;
+    length ++;
+  }
+
+  pthread_mutex_unlock(&ring->files.lock);
+
+  for (number = 0, result = 0; number < count; ++ number)
+  {
+    //
+    result += (indexes[number] >= 0);
   }
 
   return result;
 }
 
-void RemoveFastRingRegisteredFile(struct FastRing* ring, int handle)
+void RemoveFastRingRegisteredFileList(struct FastRing* ring, int* handles, uint32_t count)
 {
   struct FastRingFileEntry* entry;
+  uint64_t* levels[FILE_FILTER_LEVELS];
+  uint32_t lengths[FILE_FILTER_LEVELS];
+  int vector[FILE_UPDATE_BATCH_LENGTH];
+  uint32_t number;
+  uint32_t length;
+  uint32_t first;
 
-  if (likely((handle >= 0) &&
-             (ring  != NULL)))
+  if (unlikely((ring    == NULL) ||
+               (handles == NULL)))
+  {
+    //
+    return;
+  }
+
+  pthread_mutex_lock(&ring->files.lock);
+
+  if (likely(ring->files.filters != NULL))
   {
-    pthread_mutex_lock(&ring->files.lock);
+    GetRingFileFilter(ring, levels, lengths);
 
-    if (likely((handle < ring->files.length)          &&
-               (entry = ring->files.entries + handle) &&
-               (entry->references > 0)                &&
-               ((-- entry->references) == 0)))
+    first  = 0;
+    length = 0;
+
+    for (number = 0; number < count; ++ number)
     {
-      handle = -1;
-      ring->files.filters[entry->index >> 5] &= ~(1 << (entry->index & 31));
-      io_uring_register_files_update(&ring->ring, entry->index, &handle, 1);
+      if (likely((handles[number] >= 0) &&
+                 (entry = GetRingFileEntry(&ring->files, handles[number])) &&
+                 (entry->references > 0) &&
+                 ((-- entry->references) == 0)))
+      {
+        if ((length > 0) &&
+            ((length       == FILE_UPDATE_BATCH_LENGTH) ||
+             (entry->index != first + length)))
+        {
+          UpdateRingRegisteredFiles(ring, first, vector, length);
+          length = 0;
+        }
+
+        ClearRingFileIndex(levels, entry->index);
+
+        first          = (length == 0) ? entry->index : first;
+        vector[length] = -1;
+        length ++;
+      }
     }
 
-    pthread_mutex_unlock(&ring->files.lock);
+    UpdateRingRegisteredFiles(ring, first, vector, length);
+  }
+
+  pthread_mutex_unlock(&ring->files.lock);
+}
+
+int AddFastRingRegisteredFile(struct FastRing* ring, int handle)
+{
+  int index;
+
+  index = -EBADF;
+
+  if (likely((handle >= 0) &&
+             (ring   != NULL)))
+  {
+    //
+    AddFastRingRegisteredFileList(ring, &handle, &index, 1);
+  }
+
+  return index;
+}
+
+void RemoveFastRingRegisteredFile(struct FastRing* ring, int handle)
+{
+  //
+  RemoveFastRingRegisteredFileList(ring, &handle, 1);
+}
+
+static int HandleTransferCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  struct FastRingDescriptor* event;
+
+  if (unlikely((completion      != NULL) &&
+               (completion->res <  0)))
+  {
+    // Kernel doesn't post CQE to the target ring when installation fails,
+    // so the error is delivered to the event by plain message instead of slot index
+    event = (struct FastRingDescriptor*)descriptor->closure;
+
+    io_uring_prep_msg_ring(&descriptor->submission, event->ring->ring.ring_fd, (uint32_t)completion->res, event->identifier, 0);
+    descriptor->function = NULL;
+    descriptor->closure  = NULL;
+    SubmitFastRingDescriptor(descriptor, 0);
+    return 1;
+  }
+
+  return 0;
+}
+
+int TransferFastRingRegisteredFile(struct FastRing* ring, int index, struct FastRingDescriptor* event, uint32_t flags)
+{
+  struct FastRingDescriptor* descriptor;
+  struct FastRingDescriptor* closer;
+
+  if (unlikely((ring  == NULL) ||
+               (event == NULL) ||
+               (index <  0)    ||
+               (flags & RING_TRANSFER_FLAG_MOVE) &&
+               (index <  ring->limit / 2)))
+  {
+    // Only slots allocated by kernel can be moved, lower part is tracked by AddFastRingRegisteredFile()
+    return -EINVAL;
+  }
+
+  closer = NULL;
+
+  if (unlikely(((descriptor = AllocateFastRingDescriptor(ring, HandleTransferCompletion, event)) == NULL) ||
+               (flags & RING_TRANSFER_FLAG_MOVE) &&
+               ((closer = AllocateFastRingDescriptor(ring, NULL, NULL)) == NULL)))
+  {
+    ReleaseFastRingDescriptor(descriptor);
+    return -ENOMEM;
+  }
+
+  // Slot in the target ring is allocated by kernel from its upper part (see io_uring_register_file_alloc_range),
+  // the event receives CQE with its index
+
+  io_uring_prep_msg_ring_fd_alloc(&descriptor->submission, event->ring->ring.ring_fd, index, event->identifier, 0);
+  PrepareFastRingDescriptor(descriptor, 0);
+
+  if (closer == NULL)
+  {
+    SubmitFastRingDescriptorRange(descriptor, descriptor);
+    return 0;
   }
+
+  // Source slot is closed only when the file is installed to the target ring
+
+  io_uring_prep_close_direct(&closer->submission, index);
+  PrepareFastRingDescriptor(closer, 0);
+
+  descriptor->submission.flags |= IOSQE_IO_LINK;
+  descriptor->linked            = 1;
+  descriptor->next              = closer;
+
+  SubmitFastRingDescriptorRange(descriptor, closer);
+  return 0;
 }
 
 // Registered Buffer
@@ -1684,3 +3896,240 @@ int UpdateFastRingRegisteredBuffer(struct FastRing* ring, int index, void* addre
 
   return result;
 }
+
+// Registered Buffer Arena
+
+struct FastRingBufferChunk
+{
+  void* next;                                    // Next released chunk of the same class (with ABA tag)
+  int index;                                     // Index of registration of the region
+};
+
+static inline uint32_t GetRingBufferClass(size_t length)
+{
+  uint32_t shift;
+
+  // Classes are spaced by 1 << RING_BUFFER_CLASS_SHIFT up to 4 steps, then there are 4 classes per power of two (as in jemalloc),
+  // so a size just above a power of two wastes up to a quarter instead of a half
+
+  if (length <= (4ULL << RING_BUFFER_CLASS_SHIFT))
+  {
+    //
+    return (length - (length != 0)) >> RING_BUFFER_CLASS_SHIFT;
+  }
+
+  shift = 61 - __builtin_clzll(length - 1);
+  return ((shift - RING_BUFFER_CLASS_SHIFT) << 2) + ((length - 1) >> shift);
+}
+
+static inline size_t GetRingBufferClassSize(uint32_t number)
+{
+  return (number < 4) ?
+    ((size_t)(number + 1) << RING_BUFFER_CLASS_SHIFT) :
+    ((size_t)((number & 3) + 5) << (RING_BUFFER_CLASS_SHIFT + (number >> 2) - 1));
+}
+
+static inline size_t GetRingBufferClassAlignment(uint32_t number)
+{
+  size_t size;
+
+  // Chunks of a class are aligned at least to the lowest set bit of its size, the rest keeps ABA tag
+  size = GetRingBufferClassSize(number);
+  return size & -size;
+}
+
+static void PushRingBufferChunk(struct FastRingBufferList* list, uint32_t number, void* address, int index)
+{
+  struct FastRingBufferChunk* chunk;
+  uint32_t tag;
+
+  chunk        = (struct FastRingBufferChunk*)address;
+  chunk->index = index;
+  tag          = atomic_fetch_add_explicit(&list->tags[number], 1, memory_order_relaxed) + 1;
+
+  do chunk->next = atomic_load_explicit(&list->classes[number], memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&list->classes[number], &chunk->next, ADD_ABA_TAG(chunk, tag, GetRingBufferClassAlignment(number)), memory_order_release, memory_order_relaxed));
+}
+
+static struct FastRingBufferChunk* PopRingBufferChunk(struct FastRingBufferList* list, uint32_t number)
+{
+  struct FastRingBufferChunk* chunk;
+  void* pointer;
+
+  // Regions are never unmapped while the ring exists, so next of the chunk taken meanwhile by other thread
+  // is still readable, CAS fails on the tag in that case
+
+  do pointer = atomic_load_explicit(&list->classes[number], memory_order_acquire);
+  while ((chunk = REMOVE_ABA_TAG(struct FastRingBufferChunk, pointer, GetRingBufferClassAlignment(number))) &&
+         (!atomic_compare_exchange_weak_explicit(&list->classes[number], &pointer, chunk->next, memory_order_acquire, memory_order_relaxed)));
+
+  return chunk;
+}
+
+static void DistributeRingBufferRange(struct FastRingBufferList* list, struct FastRingBufferRegion* region, uintptr_t position, uintptr_t limit)
+{
+  uintptr_t size;
+
+  // Split the range into naturally aligned power-of-two chunks (as buddy allocator does), so alignment gaps and
+  // the tail of a region are not wasted but feed smaller classes, every class size is a multiple of the smallest one
+
+  while (position < limit)
+  {
+    size = position & -position;
+    size = (size < (RING_BUFFER_REGION_SIZE / 2)) ? size : (RING_BUFFER_REGION_SIZE / 2);
+
+    while ((position + size) > limit)
+    {
+      //
+      size >>= 1;
+    }
+
+    PushRingBufferChunk(list, GetRingBufferClass(size), (void*)position, region->index);
+    position += size;
+  }
+}
+
+static struct FastRingBufferRegion* CreateRingBufferRegion(struct FastRing* ring)
+{
+  struct FastRingBufferRegion* region;
+  void* address;
+  unsigned long mask[REGION_NODE_MASK_LENGTH];
+  uint64_t tick;
+  int index;
+
+  tick = GetRingTimerTick();
+
+  if (unlikely(tick < ring->buffers.backoff))
+  {
+    // Last attempt failed (RLIMIT_MEMLOCK, no memory), don't repeat mmap, mbind and registration on every allocation
+    return NULL;
+  }
+
+  // 1 GB pages for regions of 1 GB, otherwise 2 MB ones (size is explicit, default huge page size can be any)
+  address = mmap(NULL, RING_BUFFER_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | REGION_HUGE_PAGE_FLAGS, -1, 0);
+
+  if ((address == MAP_FAILED) &&
+      (address  = mmap(NULL, RING_BUFFER_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) != MAP_FAILED)
+  {
+    // There are no reserved huge pages, try to get transparent ones
+    madvise(address, RING_BUFFER_REGION_SIZE, MADV_HUGEPAGE);
+  }
+
+  if (unlikely(address == MAP_FAILED))
+  {
+    // Cannot map a new region
+    ring->buffers.backoff = tick + RING_BUFFER_REGION_BACKOFF;
+    return NULL;
+  }
+
+  if ((ring->buffers.node >= 0) &&
+      (ring->buffers.node <  (REGION_NODE_MASK_LENGTH * 64)))
+  {
+    // Pages are not touched yet, so they will be faulted on the node of the ring thread whichever thread carves them
+    // MPOL_PREFERRED falls back to other nodes instead of SIGBUS when the node runs out of huge pages
+    memset(mask, 0, sizeof(mask));
+    mask[ring->buffers.node / 64] |= 1UL << (ring->buffers.node % 64);
+    syscall(SYS_mbind, address, RING_BUFFER_REGION_SIZE, MPOL_PREFERRED, mask, REGION_NODE_MASK_LENGTH * 64 + 1, 0);
+  }
+
+  if (unlikely(((region = (struct FastRingBufferRegion*)calloc(1, sizeof(struct FastRingBufferRegion))) == NULL) ||
+               ((index  = AddFastRingRegisteredBuffer(ring, address, RING_BUFFER_REGION_SIZE)) < 0)))
+  {
+    munmap(address, RING_BUFFER_REGION_SIZE);
+    free(region);
+    ring->buffers.backoff = tick + RING_BUFFER_REGION_BACKOFF;
+    return NULL;
+  }
+
+  region->address  = (uint8_t*)address;
+  region->position = (uintptr_t)address;
+  region->index    = index;
+  region->next     = ring->buffers.regions;
+
+  ring->buffers.regions = region;
+
+  return region;
+}
+
+void* AllocateFastRingRegisteredBuffer(struct FastRing* ring, size_t length, int* index)
+{
+  struct FastRingBufferRegion* region;
+  struct FastRingBufferChunk* chunk;
+  uintptr_t alignment;
+  uintptr_t position;
+  uintptr_t limit;
+  uintptr_t size;
+  uint32_t number;
+
+  if (unlikely((ring   == NULL) ||
+               (index  == NULL) ||
+               (length == 0)    ||
+               (length >  (RING_BUFFER_REGION_SIZE / 2))))
+  {
+    //
+    return NULL;
+  }
+
+  number = GetRingBufferClass(length);
+
+  if (likely(chunk = PopRingBufferChunk(&ring->buffers, number)))
+  {
+    // Steady state: no locks and no registration syscalls
+    *index = chunk->index;
+    return chunk;
+  }
+
+  size      = GetRingBufferClassSize(number);
+  alignment = GetRingBufferClassAlignment(number);
+
+  pthread_mutex_lock(&ring->buffers.lock);
+
+  region   = ring->buffers.regions;
+  position = 0;
+
+  if (region != NULL)
+  {
+    limit    = (uintptr_t)region->address + RING_BUFFER_REGION_SIZE;
+    position = (region->position + alignment - 1) & ~(alignment - 1);
+
+    if ((position + size) > limit)
+    {
+      // The rest of the region is too small, leave it to smaller classes
+      DistributeRingBufferRange(&ring->buffers, region, region->position, limit);
+      region->position = limit;
+      region           = NULL;
+    }
+  }
+
+  if ((region == NULL) &&
+      (region  = CreateRingBufferRegion(ring)))
+  {
+    // Region of RING_BUFFER_REGION_SIZE always contains an aligned chunk of the largest class
+    position = (region->position + alignment - 1) & ~(alignment - 1);
+  }
+
+  if (unlikely(region == NULL))
+  {
+    pthread_mutex_unlock(&ring->buffers.lock);
+    return NULL;
+  }
+
+  DistributeRingBufferRange(&ring->buffers, region, region->position, position);
+  region->position = position + size;
+  *index           = region->index;
+
+  pthread_mutex_unlock(&ring->buffers.lock);
+  return (void*)position;
+}
+
+void ReleaseFastRingRegisteredBuffer(struct FastRing* ring, void* address, size_t length, int index)
+{
+  if (likely((ring    != NULL) &&
+             (address != NULL) &&
+             (length  != 0)    &&
+             (length  <= (RING_BUFFER_REGION_SIZE / 2))))
+  {
+    // Chunk returns to the stack of its class, the region stays registered
+    PushRingBufferChunk(&ring->buffers, GetRingBufferClass(length), address, index);
+  }
+}
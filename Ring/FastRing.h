@@ -37,6 +37,8 @@ extern "C"
 struct FastRing;
 struct FastRingEntry;
 struct FastRingDescriptor;
+struct FastRingCache;
+struct FastRingDescriptorSlab;
 struct FastRingBufferProvider;
 
 #if defined(__x86_64__) || defined(__aarch64__)
@@ -53,9 +55,9 @@ struct FastRingBufferProvider;
   SQE/CQE user_data's bit layout:
   [63:60]  LA57/TBI/MTE reserve (4)
   [59:48]  Tag MSB (12)
-  [47:09]  Pointer (39) <-- middle address field, 512 bytes aligned
-  [08:06]  Options (3)
-  [05:00]  Tag LSB (6)
+  [47:08]  Pointer (40) <-- middle address field, 256 bytes aligned
+  [07:05]  Options (3)
+  [04:00]  Tag LSB (5)
 */
 
 #define RING_DESC_STATE_FREE       0
@@ -64,14 +66,62 @@ struct FastRingBufferProvider;
 #define RING_DESC_STATE_LOCKED     3
 #define RING_DESC_STATE_SUBMITTED  4
 
-#define RING_DESC_ALIGNMENT        512
-#define RING_DESC_INTEGRITY_MASK   0x0fff00000000003fULL
+#define RING_DESC_ALIGNMENT        256
+#define RING_DESC_INTEGRITY_MASK   0x0fff00000000001fULL
 
 #define RING_DESC_OPTION_IGNORE    (RING_DESC_ALIGNMENT >> 1)
 #define RING_DESC_OPTION_USER1     (RING_DESC_ALIGNMENT >> 2)
 #define RING_DESC_OPTION_USER2     (RING_DESC_ALIGNMENT >> 3)
 #define RING_DESC_OPTION_MASK      (RING_DESC_OPTION_IGNORE | RING_DESC_OPTION_USER1 | RING_DESC_OPTION_USER2)
 
+#ifndef RING_DESC_CACHE_LENGTH
+#define RING_DESC_CACHE_LENGTH     32
+#endif
+
+#define RING_DESC_CACHE_BATCH      (RING_DESC_CACHE_LENGTH / 2)
+
+#ifndef RING_DESC_SLAB_SIZE
+#define RING_DESC_SLAB_SIZE        (2ULL << 20)
+#endif
+
+#define RING_DESC_SLAB_LENGTH      (RING_DESC_SLAB_SIZE / RING_DESC_ALIGNMENT)
+
+#ifndef RING_BUFFER_REGION_SHIFT
+#define RING_BUFFER_REGION_SHIFT   22
+#endif
+
+#define RING_BUFFER_REGION_SIZE    (1ULL << RING_BUFFER_REGION_SHIFT)
+
+#ifndef RING_BUFFER_REGION_BACKOFF
+#define RING_BUFFER_REGION_BACKOFF 1000
+#endif
+#define RING_BUFFER_CLASS_SHIFT    6
+#define RING_BUFFER_CLASS_COUNT    (4 * (RING_BUFFER_REGION_SHIFT - RING_BUFFER_CLASS_SHIFT - 2))
+
+#ifndef RING_CQE_BATCH_LENGTH
+#define RING_CQE_BATCH_LENGTH      32
+#endif
+
+#ifndef RING_CQE_PREFETCH_DISTANCE
+#define RING_CQE_PREFETCH_DISTANCE  8
+#endif
+
+// Note: RING_FEATURE_STATISTICS changes layout of structures, it has to be defined for all units of the build
+
+#ifdef RING_FEATURE_STATISTICS
+#define RING_STATISTICS_OPCODE_COUNT      64
+#define RING_STATISTICS_HISTOGRAM_SHIFT   2
+#define RING_STATISTICS_HISTOGRAM_LENGTH  128
+#endif
+
+#define RING_DESC_SLAB_RESIDENT    0
+#define RING_DESC_SLAB_PARKED      1
+
+#define RING_CACHE_ACTIVE          0
+#define RING_CACHE_ABANDONED       1
+#define RING_CACHE_FLUSHING        2
+#define RING_CACHE_DETACHED        3
+
 #define RING_FLUSH_STATE_FREE      0
 #define RING_FLUSH_STATE_PENDING   1
 #define RING_FLUSH_STATE_LOCKED    2
@@ -88,10 +138,16 @@ struct FastRingBufferProvider;
 #define RING_TRACE_ACTION_HANDLE   0
 #define RING_TRACE_ACTION_RELEASE  1
 
+#define RING_MODE_DEFAULT          0
+#define RING_MODE_SQPOLL           (1U << 0)
+#define RING_MODE_DEFER_TASKRUN    (1U << 1)
+#define RING_MODE_EARLY_ADVANCE    (1U << 2)
+
 #define RING_CONDITION_GUARD       (1U << 16)
 #define RING_CONDITION_UPDATE      (1U << 17)
 #define RING_CONDITION_REMOVE      (1U << 18)
-#define RING_CONDITION_MASK        (RING_CONDITION_GUARD | RING_CONDITION_UPDATE | RING_CONDITION_REMOVE)
+#define RING_CONDITION_READY       (1U << 19)
+#define RING_CONDITION_MASK        (RING_CONDITION_GUARD | RING_CONDITION_UPDATE | RING_CONDITION_REMOVE | RING_CONDITION_READY)
 
 typedef int (*HandleFastRingCompletionFunction)(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason);
 typedef void (*HandleFastRingFlushFunction)(void* closure, int reason);
@@ -99,13 +155,16 @@ typedef void (*TraceFastRingFunction)(int action, struct FastRingDescriptor* des
 typedef void (*HandleFastRingPollFunction)(int handle, uint32_t flags, void* closure, uint64_t options);
 typedef void (*HandleFastRingWatchFunction)(struct FastRingDescriptor* descriptor, int result);
 typedef void (*HandleFastRingTimeoutFunction)(struct FastRingDescriptor* descriptor);
+typedef void (*HandleFastRingCacheFunction)(struct FastRingCache* cache);
 
 struct FastRingPollData
 {
   int handle;
+  ATOMIC(uint32_t) events;
   uint64_t flags;
   ATOMIC(uint32_t) condition;
   HandleFastRingPollFunction function;
+  struct FastRingDescriptor* next;
 };
 
 struct FastRingWatchData
@@ -125,6 +184,12 @@ struct FastRingTimeoutData
   HandleFastRingTimeoutFunction function;
 };
 
+struct FastRingOutboundData
+{
+  uint64_t number;                               // Count of notifications about accepted data (0 - not notified yet)
+  uint32_t flags;                                // Kind of transmission, FASTSOCKET_OUTBOUND_*
+};
+
 struct FastRingSocketData
 {
   uint64_t number;
@@ -140,40 +205,97 @@ union FastRingData
   uint64_t number;
   struct FastRingPollData poll;
   struct FastRingWatchData watch;
-  struct FastRingSocketData socket;
   struct FastRingTimeoutData timeout;
+  struct FastRingOutboundData outbound;
+  uint8_t data[48];
+};
+
+union FastRingExtension
+{
+  struct FastRingSocketData socket;
   uint8_t data[256];
 };
 
+struct FastRingDescriptorStamp
+{
+  uint64_t time;                                 // Time of submission in nanoseconds (CLOCK_MONOTONIC, 0 - not stamped)
+  uint32_t opcode;                               // Submitted opcode
+};
+
 struct FastRingDescriptor
 {
   struct FastRing* ring;                         // (  8) Related ring
   ATOMIC(uint32_t) state;                        // ( 12) RING_DESC_STATE_*
-
-  uint32_t length;                               // ( 16) Length of submission
-  uint32_t linked;                               // ( 20) Count of following linked descriptors in chain (when check is required)
-  uint32_t alignment;                            // ( 24)
+  ATOMIC(uint32_t) tag;                          // ( 16) Lock-free stack tag (see FastRing's available)
+  ATOMIC(uint32_t) references;                   // ( 20) Count of references (SQEs, files, etc.)
+  uint16_t length;                               // ( 22) Length of submission
+  uint16_t linked;                               // ( 24) Count of following linked descriptors in chain (when check is required)
   uint64_t identifier;                           // ( 32) Prepared entry identifier (for SQEs and CQEs)
-  ATOMIC(uint32_t) tag;                          // ( 36) Lock-free stack tag (see FastRing's available)
-  ATOMIC(uint32_t) references;                   // ( 40) Count of references (SQEs, files, etc.)
-  struct FastRingDescriptor* previous;           // ( 48) Previous linked descriptor (useful for chains with IOSQE_CQE_SKIP_SUCCESS)
-  ATOMIC(struct FastRingDescriptor*) next;       // ( 56) Next descriptor in the queue (available, pending, IOSQE_CQE_SKIP_SUCCESS)
-  ATOMIC(struct FastRingDescriptor*) heap;       // ( 64) Next allocated descriptor (see FastRing's heap)
+  struct FastRingDescriptor* previous;           // ( 40) Previous linked descriptor (useful for chains with IOSQE_CQE_SKIP_SUCCESS)
+  ATOMIC(struct FastRingDescriptor*) next;       // ( 48) Next descriptor in the queue (available, pending, IOSQE_CQE_SKIP_SUCCESS)
+  void* closure;                                 // ( 56) User's closure
+  HandleFastRingCompletionFunction function;     // ( 64) Handler function
 
-  void* closure;                                 // ( 72) User's closure
-  HandleFastRingCompletionFunction function;     // ( 80) Handler function
-  struct io_uring_sqe submission;                // (144) Copy of actual SQE
-  uint64_t reserved[8];                          // (208) Reserved for IORING_SETUP_SQE128
+  struct io_uring_sqe submission;                // (128) Copy of actual SQE
 
-  union FastRingData data;                       // (464) User-specified data
-};                                               // ~ 512 bytes block including malloc header (usualy 24 bytes)
+  union
+  {
+    uint64_t reserved[8];                        // (192) Reserved for IORING_SETUP_SQE128
+    struct FastRingDescriptorStamp stamp;        //       Submission stamp (RING_FEATURE_STATISTICS, only for 64-byte SQEs)
+  };
+
+  struct FastRingDescriptorSlab* slab;           // (200) Slab the descriptor is carved from
+  union FastRingExtension* extension;            // (208) Side allocation for large payloads (see GetFastRingDescriptorExtension)
+  union FastRingData data;                       // (256) User-specified data
+};                                               // Hot lines: header (0..63) always, SQE copy (64..127) on submission, tail (192..255) on completion
+
+struct FastRingCache
+{
+  ATOMIC(uint32_t) state;                        // RING_CACHE_*
+  struct FastRingCache* next;                    // Next cache of the list
+  void* owner;                                   // Owner of the list (valid until RING_CACHE_DETACHED)
+  HandleFastRingCacheFunction function;          // Gives cached objects back to the owner when the thread exits
+};
+
+struct FastRingCacheList
+{
+  ATOMIC(struct FastRingCache*) top;             // Caches of all threads (owned by the list)
+  uint64_t serial;                               // Unique identity of the list, key of per-thread maps (see GetFastRingCache)
+};
+
+struct FastRingDescriptorCache
+{
+  struct FastRingCache header;                   // Owner is the set
+  uint32_t count;                                // Count of cached descriptors
+  struct FastRingDescriptor* stack[RING_DESC_CACHE_LENGTH];
+#ifdef RING_FEATURE_STATISTICS
+  ATOMIC(uint64_t) hits;                         // Count of allocations served by the cache (written by owner only)
+#endif
+};
+
+struct FastRingDescriptorSlab
+{
+  struct FastRingDescriptorSlab* next;           // Next slab of the set
+  uint8_t* address;                              // Mapped region of RING_DESC_SLAB_SIZE
+  uint32_t state;                                // RING_DESC_SLAB_*
+  uint32_t position;                             // Count of carved descriptors
+  uint32_t count;                                // Count of available descriptors (used by trim only)
+  uint32_t* tags;                                // Tags of descriptors saved on parking
+};
 
 struct FastRingDescriptorSet
 {
-  ATOMIC(struct FastRingDescriptor*) heap;       // Last allocated descriptor (required for release)
+  ATOMIC(struct FastRingDescriptorSlab*) slabs;  // Last mapped slab (required for release)
   ATOMIC(struct FastRingDescriptor*) available;  // Last available (free) descriptor
   ATOMIC(struct FastRingDescriptor*) pending;    // Last pending descriptor prepared for submission
   struct FastRingDescriptor* submitting;         // Next descriptor to submit
+  struct FastRingCacheList caches;               // Per-thread caches in front of available
+  pthread_mutex_t lock;                          // Slab carving and trimming
+  uint32_t count;                                // Count of resident slabs
+  uint32_t limit;                                // High-water mark of resident slabs (0 - unlimited)
+#ifdef RING_FEATURE_STATISTICS
+  ATOMIC(uint64_t) allocated;                    // Count of descriptors taken from the shared stack or carved from slabs
+#endif
 };
 
 struct FastRingFlusher
@@ -205,18 +327,32 @@ struct FastRingTrace
 
 struct FastRingFileEntry
 {
-  uint32_t tag;                                  // Tag of descriptor
+  ATOMIC(struct FastRingDescriptor*) descriptor; // Descriptor for Poll API with ABA tag of descriptor (see ADD_ABA_TAG)
   uint32_t index;                                // | Index in registered file table
   uint32_t references;                           // | Count of references to registered file table
-  struct FastRingDescriptor* descriptor;         // Descriptor for Poll API
+};
+
+struct FastRingFileTable
+{
+  struct FastRingFileTable* previous;            // Replaced table (kept until release, lock-free readers can still hold it)
+  uint32_t length;                               // Count of page slots
+  ATOMIC(struct FastRingFileEntry*) pages[0];    // Pages of entries, never moved once allocated (NULL - not allocated yet)
 };
 
 struct FastRingFileList
 {
-  pthread_mutex_t lock;                          //
-  uint32_t length;                               // Length of data in elements
-  uint32_t* filters;                             // Bitmap of registered files (Regitered File API)
-  struct FastRingFileEntry* entries;             //
+  pthread_mutex_t lock;                          // Growth of the table and Registered File API
+  ATOMIC(struct FastRingFileTable*) table;       // Current table of pages (lock-free lookup)
+  uint64_t* filters;                             // Hierarchical bitmap of used registered files (Registered File API)
+  struct FastRingDescriptor* ready;              // Poll API descriptors with unconsumed readiness (RING_POLL_LEVEL, owned by ring's thread)
+};
+
+struct FastRingBufferRegion
+{
+  struct FastRingBufferRegion* next;             // Next region of the arena
+  uint8_t* address;                              // Mapped region of RING_BUFFER_REGION_SIZE
+  uintptr_t position;                            // Address of the rest to carve
+  int index;                                     // Index of registration (the whole region is one fixed buffer)
 };
 
 struct FastRingBufferList
@@ -226,6 +362,36 @@ struct FastRingBufferList
   uint32_t length;                               // List length
   uint32_t position;                             // Current scanning position
   struct iovec* vectors;                         // List of vectors
+
+  struct FastRingBufferRegion* regions;          // Regions of the arena, the first one is being carved (under lock)
+  uint64_t backoff;                              // Tick before which a failed region is not tried again (see RING_BUFFER_REGION_BACKOFF)
+  int node;                                      // NUMA node of the ring thread regions are placed to (negative - unknown)
+  ATOMIC(uint32_t) tags[RING_BUFFER_CLASS_COUNT];  // ABA tags of the stacks
+  ATOMIC(void*) classes[RING_BUFFER_CLASS_COUNT];  // Stacks of released chunks per size class (with ABA tag)
+};
+
+#ifdef RING_FEATURE_STATISTICS
+struct FastRingStatistics
+{
+  ATOMIC(uint64_t) submissions;                  // SQEs passed to SQ (from the pending queue or prepared in place)
+  ATOMIC(uint64_t) completions;                  // CQEs reaped
+  ATOMIC(uint64_t) calls;                        // Calls of io_uring_submit*() and io_uring_get_events()
+  ATOMIC(uint64_t) overflows;                    // CQ overflow events
+  ATOMIC(uint64_t) flushes;                      // Calls of flush handlers
+  ATOMIC(uint64_t) depth;                        // Descriptors taken from the pending queue by the last WaitForFastRing()
+  ATOMIC(uint64_t) peak;                         // Maximal depth
+  ATOMIC(uint64_t) allocated;                    // Descriptors taken from the shared stack or carved from slabs
+  ATOMIC(uint64_t) cached;                       // Descriptors allocated from per-thread caches
+  ATOMIC(uint64_t) histograms[RING_STATISTICS_OPCODE_COUNT][RING_STATISTICS_HISTOGRAM_LENGTH];  // Submit-to-complete latency (see GetFastRingStatisticsBound)
+};
+#endif
+
+struct FastRingParameters
+{
+  uint32_t length;                               // Length of SQ (0 - auto-size from RLIMIT_NOFILE)
+  uint32_t mode;                                 // RING_MODE_*
+  int cpu;                                       // CPU of SQ polling thread (RING_MODE_SQPOLL, negative - not bound)
+  uint32_t idle;                                 // Idle time of SQ polling thread in milliseconds before it sleeps (RING_MODE_SQPOLL, 0 - kernel's default)
 };
 
 struct FastRing
@@ -235,6 +401,7 @@ struct FastRing
   struct io_uring_params parameters;             //
   struct FastRingTrace trace;                    //
   pid_t thread;                                  // TID of processing thread
+  uint32_t mode;                                 // RING_MODE_*
 
   struct FastRingDescriptorSet descriptors;      //
   struct FastRingFlusherSet flushers;            //
@@ -243,6 +410,11 @@ struct FastRing
   ATOMIC(uint16_t) groups;                       // Count of buffer rings (GetFastRingBufferGroup)
   struct FastRingFileList files;                 // List of watching file descriptors (Poll API)
   struct FastRingBufferList buffers;             // List of registered buffers (Registered Buffer API)
+  struct FastRingTimerWheel* timers;             // Timer wheel (Timer API, created on demand)
+
+#ifdef RING_FEATURE_STATISTICS
+  struct FastRingStatistics statistics;          // Counters written by the ring thread only (except allocated and cached)
+#endif
 };
 
 int WaitForFastRing(struct FastRing* ring, uint32_t interval, sigset_t* mask);
@@ -250,8 +422,17 @@ int WaitForFastRing(struct FastRing* ring, uint32_t interval, sigset_t* mask);
 void PrepareFastRingDescriptor(struct FastRingDescriptor* descriptor, int option);
 void SubmitFastRingDescriptor(struct FastRingDescriptor* descriptor, int option);
 void SubmitFastRingDescriptorRange(struct FastRingDescriptor* first, struct FastRingDescriptor* last);
+
+// Note: GetFastRingSubmission returns kernel's SQE when it is called by the ring thread and no descriptors are pending, otherwise descriptor's copy,
+// the result has to be prepared and passed to CommitFastRingSubmission immediately, which copies kernel's SQE back to the descriptor
+struct io_uring_sqe* GetFastRingSubmission(struct FastRingDescriptor* descriptor);
+void CommitFastRingSubmission(struct FastRingDescriptor* descriptor, struct io_uring_sqe* submission, int option);
 struct FastRingDescriptor* AllocateFastRingDescriptor(struct FastRing* ring, HandleFastRingCompletionFunction function, void* closure);
 
+// Note: GetFastRingDescriptorExtension zeroes the extension only when it is allocated, later it keeps the contents left by the previous owner
+// of the recycled descriptor, so callers must set every field they use
+union FastRingExtension* GetFastRingDescriptorExtension(struct FastRingDescriptor* descriptor);
+
 // Note: ReleaseFastRingDescriptor has to be used only in special cases, normally release will be done automatically by result of HandleFastRingCompletionFunction
 int ReleaseFastRingDescriptor(struct FastRingDescriptor* descriptor);
 
@@ -262,8 +443,21 @@ uint16_t GetFastRingBufferGroup(struct FastRing* ring);
 int IsFastRingThread(struct FastRing* ring);
 
 struct FastRing* CreateFastRing(uint32_t length);
+struct FastRing* CreateFastRingEx(struct FastRingParameters* parameters);
 void ReleaseFastRing(struct FastRing* ring);
 
+int ReserveFastRingDescriptors(struct FastRing* ring, uint32_t count, uint32_t limit);
+
+void InitializeFastRingCacheList(struct FastRingCacheList* list);
+void ReleaseFastRingCacheList(struct FastRingCacheList* list, HandleFastRingCacheFunction function);
+struct FastRingCache* GetFastRingCache(struct FastRingCacheList* list, size_t size, HandleFastRingCacheFunction function, void* owner);
+
+#ifdef RING_FEATURE_STATISTICS
+// Note: GetFastRingStatistics doesn't take locks and can be called from any thread, counters of the snapshot are consistent each alone
+int GetFastRingStatistics(struct FastRing* ring, struct FastRingStatistics* snapshot);
+uint64_t GetFastRingStatisticsBound(uint32_t index);
+#endif
+
 // Poll
 
 #define RING_POLL_FLAGS_SHIFT  32
@@ -284,14 +478,21 @@ void ReleaseFastRing(struct FastRing* ring);
 #define RING_POLL_ERROR   (uint64_t)POLLERR
 #define RING_POLL_HANGUP  (uint64_t)POLLHUP
 #define RING_POLL_REPEAT  (1ULL << 63)
+#define RING_POLL_LEVEL   (1ULL << 62)
+#define RING_POLL_PROBE   (1ULL << 61)
 
 // Poll API descriptors with RING_POLL_REPEAT are automatically re-armed after
 // callback, unless removed, completed as kernel multishot (CQE_F_MORE), or
 // triggered by terminal HUP/ERR events.
 
+// RING_POLL_LEVEL emulates level triggering over a kernel multishot poll: reported events are
+// kept as readiness and delivered again by every WaitForFastRing() until they are cleared by
+// ClearFastRingPoll() (i.e. after EAGAIN) or, with RING_POLL_PROBE, by non-blocking poll(2)
+
 int AddFastRingPoll(struct FastRing* ring, int handle, uint64_t flags, HandleFastRingPollFunction function, void* closure);
 int UpdateFastRingPoll(struct FastRing* ring, int handle, uint64_t flags);
 int RemoveFastRingPoll(struct FastRing* ring, int handle);
+int ClearFastRingPoll(struct FastRing* ring, int handle, uint32_t events);
 void DestroyFastRingPoll(struct FastRing* ring, HandleFastRingPollFunction function, void* closure);
 
 int SetFastRingPoll(struct FastRing* ring, int handle, uint64_t flags, HandleFastRingPollFunction function, void* closure);
@@ -317,6 +518,54 @@ struct FastRingDescriptor* SetFastRingTimeout(struct FastRing* ring, struct Fast
 struct FastRingDescriptor* SetFastRingCertainTimeout(struct FastRing* ring, struct FastRingDescriptor* descriptor, struct timeval* interval, uint64_t flags, HandleFastRingTimeoutFunction function, void* closure);
 struct FastRingDescriptor* SetFastRingPreciseTimeout(struct FastRing* ring, struct FastRingDescriptor* descriptor, struct timespec* interval, uint64_t flags, HandleFastRingTimeoutFunction function, void* closure);
 
+// Timer
+
+#define RING_TIMER_LEVELS      4
+#define RING_TIMER_BITS        6
+#define RING_TIMER_SLOTS       (1U << RING_TIMER_BITS)
+#define RING_TIMER_RANGE       (1ULL << (RING_TIMER_LEVELS * RING_TIMER_BITS))
+
+#define RING_TIMER_FLAG_REPEAT   (1U << 0)
+#define RING_TIMER_FLAG_PRECISE  (1U << 1)
+
+#define RING_TIMER_STATE_IDLE       0
+#define RING_TIMER_STATE_ADVANCING  1
+
+struct FastRingTimer;
+
+typedef void (*HandleFastRingTimerFunction)(struct FastRingTimer* timer, void* closure);
+
+struct FastRingTimer
+{
+  struct FastRingTimer* next;                    // Next timer in the slot
+  struct FastRingTimer** previous;               // Link to the timer in the slot (NULL - timer is not armed)
+  uint64_t expiration;                           // Tick of expiration with applied slack (milliseconds of CLOCK_MONOTONIC)
+  uint64_t schedule;                             // Tick of expiration without slack (base of the next period)
+  uint32_t interval;                             // Interval in milliseconds
+  uint32_t slack;                                // Tolerance in milliseconds (0 - ring's default, see SetFastRingTimerSlack)
+  uint16_t position;                             // Index of slot in the wheel (level * RING_TIMER_SLOTS + slot)
+  uint16_t flags;                                // RING_TIMER_FLAG_*
+  HandleFastRingTimerFunction function;          //
+  void* closure;                                 //
+};
+
+struct FastRingTimerWheel
+{
+  uint64_t current;                              // Current tick of the wheel
+  uint64_t deadline;                             // Tick of armed kernel timeout
+  uint32_t count;                                // Count of armed timers
+  uint32_t state;                                // RING_TIMER_STATE_*
+  uint32_t slack;                                // Default tolerance of timers in milliseconds
+  struct FastRingDescriptor* descriptor;         // Kernel timeout driving the wheel (NULL - not armed)
+  uint64_t bitmaps[RING_TIMER_LEVELS];           // Bitmaps of non-empty slots per level
+  struct FastRingTimer* slots[RING_TIMER_LEVELS * RING_TIMER_SLOTS];
+};
+
+// Note: Timer API has to be used only in the ring thread, struct FastRingTimer is owned by the caller and has to be zeroed before first use
+int SetFastRingTimer(struct FastRing* ring, struct FastRingTimer* timer, uint32_t interval, uint32_t flags, HandleFastRingTimerFunction function, void* closure);
+void CancelFastRingTimer(struct FastRing* ring, struct FastRingTimer* timer);
+int SetFastRingTimerSlack(struct FastRing* ring, uint32_t slack);
+
 // Event
 
 struct FastRingDescriptor* CreateFastRingEvent(struct FastRing* ring, HandleFastRingCompletionFunction function, void* closure);
@@ -324,35 +573,93 @@ int SubmitFastRingEvent(struct FastRing* ring, struct FastRingDescriptor* event,
 
 // Buffer Provider
 
+#ifndef IOU_PBUF_RING_INC
+#define IOU_PBUF_RING_INC             2
+#endif
+
+#ifndef IORING_CQE_F_BUF_MORE
+#define IORING_CQE_F_BUF_MORE         (1U << 4)
+#endif
+
+#define RING_BUFFER_FLAG_INCREMENTAL  (1U << 0)
+#define RING_BUFFER_FLAG_ADAPTIVE     (1U << 1)  // Posted surplus is withdrawn from the tail only without SQPOLL (the SQ thread may hold a selected, uncommitted buffer)
+
+#ifndef RING_BUFFER_ADAPTIVE_RATIO
+#define RING_BUFFER_ADAPTIVE_RATIO    8
+#endif
+
+#ifndef RING_BUFFER_ADAPTIVE_WINDOW
+#define RING_BUFFER_ADAPTIVE_WINDOW   1000
+#endif
+
+#define RING_BUFFER_MAXIMUM_COUNT     32768
+
 typedef void* (*CreateRingBufferFunction)(size_t length, void* closure);
 typedef void (*ReleaseRingBufferFunction)(void* buffer);
 
+struct FastRingBufferStatistics
+{
+  uint32_t count;                                // Buffers owned by the provider (posted to the ring or being consumed)
+  uint32_t target;                               // Count of buffers to keep (changes with RING_BUFFER_FLAG_ADAPTIVE only)
+  uint32_t minimum;                              // Initial count, target never goes below
+  uint32_t peak;                                 // Maximal count
+  uint64_t consumed;                             // Consumed buffers (whole ones in case of RING_BUFFER_FLAG_INCREMENTAL)
+  uint64_t shortages;                            // Completions with -ENOBUFS
+  uint64_t grown;                                // Buffers added by growth
+  uint64_t shrunk;                               // Buffers left to consumers by shrinking
+  uint64_t reclaimed;                            // Posted buffers withdrawn and released by shrinking (never with RING_MODE_SQPOLL)
+};
+
 struct FastRingBufferProvider
 {
   struct FastRing* ring;
   struct io_uring_buf_reg registration;
   struct io_uring_buf_ring* data;
   uint32_t length;
+  uint32_t flags;                                // RING_BUFFER_FLAG_* (INCREMENTAL is dropped when kernel has no support)
+  uint32_t* offsets;                             // Consumed part of every buffer (RING_BUFFER_FLAG_INCREMENTAL)
+
+  CreateRingBufferFunction function;             // Source of buffers for growth (RING_BUFFER_FLAG_ADAPTIVE)
+  ReleaseRingBufferFunction release;             // Sink of reclaimed buffers (NULL - surplus is left to consumers only)
+  void* closure;                                 //
+  uint16_t* spares;                              // Stack of unused buffer ids
+  uint32_t spare;                                // Count of unused buffer ids
+  struct FastRingTimer timer;                    // Window of RING_BUFFER_ADAPTIVE_WINDOW milliseconds
+  uint64_t marks[3];                             // Consumed buffers and shortages at start of the window, consumed buffers to finish the last refill
+
+  struct FastRingBufferStatistics statistics;    // Written by the ring thread only
   uintptr_t map[0];
 };
 
 struct FastRingBufferProvider* CreateFastRingBufferProvider(struct FastRing* ring, uint16_t group, uint16_t count, uint32_t length, CreateRingBufferFunction function, void* closure);
+struct FastRingBufferProvider* CreateFastRingBufferProviderEx(struct FastRing* ring, uint16_t group, uint16_t count, uint32_t length, uint32_t flags, CreateRingBufferFunction function, ReleaseRingBufferFunction release, void* closure);
 void ReleaseFastRingBufferProvider(struct FastRingBufferProvider* provider, ReleaseRingBufferFunction function);
 
 void PrepareFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_sqe* submission);
 uint8_t* GetFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_cqe* completion);
 void AdvanceFastRingBuffer(struct FastRingBufferProvider* provider, struct io_uring_cqe* completion, CreateRingBufferFunction function, void* closure);
+int GetFastRingBufferAvailability(struct FastRingBufferProvider* provider);
 
 // Registered File
 
+#define RING_TRANSFER_FLAG_MOVE  (1U << 0)
+
 int AddFastRingRegisteredFile(struct FastRing* ring, int handle);
 void RemoveFastRingRegisteredFile(struct FastRing* ring, int handle);
+int AddFastRingRegisteredFileList(struct FastRing* ring, int* handles, int* indexes, uint32_t count);
+void RemoveFastRingRegisteredFileList(struct FastRing* ring, int* handles, uint32_t count);
+int TransferFastRingRegisteredFile(struct FastRing* ring, int index, struct FastRingDescriptor* event, uint32_t flags);
 
 // Registered Buffer
 
 int AddFastRingRegisteredBuffer(struct FastRing* ring, void* address, size_t length);
 int UpdateFastRingRegisteredBuffer(struct FastRing* ring, int index, void* address, size_t length);
 
+// Registered Buffer Arena
+
+void* AllocateFastRingRegisteredBuffer(struct FastRing* ring, size_t length, int* index);
+void ReleaseFastRingRegisteredBuffer(struct FastRing* ring, void* address, size_t length, int index);
+
 #ifdef __cplusplus
 }
 
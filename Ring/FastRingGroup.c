@@ -0,0 +1,528 @@
+#define _GNU_SOURCE
+
+#include "FastRingGroup.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#ifndef likely
+#define likely(condition)    __builtin_expect(!!(condition), 1)
+#endif
+
+#ifndef unlikely
+#define unlikely(condition)  __builtin_expect(!!(condition), 0)
+#endif
+
+static __thread struct FastRingGroupShard* current = NULL;
+
+static int HandleWakeCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  if ((completion      != NULL) &&
+      (completion->res >= 0))
+  {
+    // Wake-up is consumed, WaitForFastRing() returns to check the state
+    SubmitFastRingDescriptor(descriptor, 0);
+    return 1;
+  }
+
+  return 0;
+}
+
+static void* DoWork(void* argument)
+{
+  struct FastRingGroupShard* shard;
+  struct FastRingDescriptor* descriptor;
+  struct FastRingGroup* group;
+  struct FastRing* ring;
+  unsigned int node;
+  int result;
+  int handle;
+
+  shard   = (struct FastRingGroupShard*)argument;
+  group   = shard->group;
+  current = shard;
+
+  // Thread is already pinned, so ring, descriptor slabs and everything allocated
+  // by the handlers are placed on the node of the CPU (there is no glibc wrapper)
+
+  syscall(SYS_set_mempolicy, MPOL_LOCAL, NULL, 0);
+
+  if (syscall(SYS_getcpu, NULL, &node, NULL) == 0)
+  {
+    //
+    shard->node = node;
+  }
+
+  ring   = CreateFastRingEx(&group->parameters);
+  handle = -1;
+
+  if ((ring       != NULL) &&
+      ((handle     = eventfd(0, EFD_CLOEXEC)) >= 0) &&
+      (descriptor  = AllocateFastRingDescriptor(ring, HandleWakeCompletion, NULL)))
+  {
+    // External threads cannot submit to the ring directly, the event file lets them wake the shard up
+    io_uring_prep_read(&descriptor->submission, handle, &descriptor->data.number, sizeof(uint64_t), 0);
+    SubmitFastRingDescriptor(descriptor, 0);
+  }
+
+  pthread_mutex_lock(&group->lock);
+
+  shard->ring   = ring;
+  shard->handle = handle;
+  group->ready ++;
+
+  if (unlikely(ring == NULL))
+  {
+    // Don't let other shards start, CreateFastRingGroup() will fail
+    atomic_store_explicit(&group->state, RING_GROUP_STATE_STOPPED, memory_order_release);
+  }
+
+  pthread_cond_broadcast(&group->condition);
+
+  while ((group->ready < group->count) &&
+         (atomic_load_explicit(&group->state, memory_order_acquire) == RING_GROUP_STATE_RUNNING))
+  {
+    //
+    pthread_cond_wait(&group->condition, &group->lock);
+  }
+
+  pthread_mutex_unlock(&group->lock);
+
+  if (likely((ring != NULL) &&
+             (atomic_load_explicit(&group->state, memory_order_acquire) == RING_GROUP_STATE_RUNNING)))
+  {
+    if (group->function != NULL)
+    {
+      //
+      group->function(shard, RING_GROUP_EVENT_START, group->closure);
+    }
+
+    while (atomic_load_explicit(&group->state, memory_order_acquire) == RING_GROUP_STATE_RUNNING)
+    {
+      result = WaitForFastRing(ring, group->interval, NULL);
+
+      if (unlikely((result <  0) &&
+                   (result != -EINTR)))
+      {
+        // Unrecoverable state of the ring
+        break;
+      }
+    }
+
+    if (group->function != NULL)
+    {
+      //
+      group->function(shard, RING_GROUP_EVENT_STOP, group->closure);
+    }
+
+    // Submit what is left in the queue (wake-ups of other shards, final sends)
+    WaitForFastRing(ring, 0, NULL);
+  }
+
+  // Other shards can still send messages to the ring, wait for them before release
+
+  pthread_mutex_lock(&group->lock);
+
+  group->stopped ++;
+  pthread_cond_broadcast(&group->condition);
+
+  while (group->stopped < group->count)
+  {
+    //
+    pthread_cond_wait(&group->condition, &group->lock);
+  }
+
+  // External callers check the ring under the lock, no call can be submitted after this point
+
+  shard->ring   = NULL;
+  shard->handle = -1;
+  pthread_mutex_unlock(&group->lock);
+
+  if (ring != NULL)
+  {
+    // Drain calls accepted before the stop, the rest get RING_REASON_RELEASED from ReleaseFastRing()
+    WaitForFastRing(ring, 0, NULL);
+  }
+
+  current = NULL;
+
+  ReleaseFastRing(ring);
+
+  if (handle >= 0)
+  {
+    //
+    close(handle);
+  }
+
+  return NULL;
+}
+
+struct FastRingGroup* CreateFastRingGroup(uint32_t count, struct FastRingParameters* parameters, uint32_t interval, HandleFastRingGroupFunction function, void* closure)
+{
+  struct FastRingGroupShard* shard;
+  struct FastRingGroup* group;
+  pthread_attr_t attribute;
+  cpu_set_t available;
+  cpu_set_t set;
+  uint32_t number;
+  uint32_t index;
+  int list[CPU_SETSIZE];
+  int cpu;
+
+  if (unlikely(parameters == NULL))
+  {
+    //
+    return NULL;
+  }
+
+  number = 0;
+
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &available) == 0)
+  {
+    for (cpu = 0; cpu < CPU_SETSIZE; ++ cpu)
+    {
+      if (CPU_ISSET(cpu, &available))
+      {
+        list[number] = cpu;
+        number ++;
+      }
+    }
+  }
+
+  count += (count == 0) * number;
+  count += (count == 0);
+
+  group = (struct FastRingGroup*)calloc(1, sizeof(struct FastRingGroup) + count * sizeof(struct FastRingGroupShard));
+
+  if (unlikely(group == NULL))
+  {
+    //
+    return NULL;
+  }
+
+  atomic_init(&group->state, RING_GROUP_STATE_RUNNING);
+
+  group->count      = count;
+  group->interval   = interval;
+  group->parameters = *parameters;
+  group->function   = function;
+  group->closure    = closure;
+
+  pthread_mutex_init(&group->lock, NULL);
+  pthread_cond_init(&group->condition, NULL);
+
+  for (index = 0; index < count; ++ index)
+  {
+    shard         = group->shards + index;
+    shard->group  = group;
+    shard->index  = index;
+    shard->cpu    = (number > 0) ? list[index % number] : -1;
+    shard->node   = -1;
+    shard->handle = -1;
+
+    pthread_attr_init(&attribute);
+
+    if (shard->cpu >= 0)
+    {
+      CPU_ZERO(&set);
+      CPU_SET(shard->cpu, &set);
+      pthread_attr_setaffinity_np(&attribute, sizeof(cpu_set_t), &set);
+    }
+
+    if (unlikely(pthread_create(&shard->thread, &attribute, DoWork, shard) != 0))
+    {
+      pthread_attr_destroy(&attribute);
+      pthread_mutex_lock(&group->lock);
+
+      group->count = index;
+      atomic_store_explicit(&group->state, RING_GROUP_STATE_STOPPED, memory_order_release);
+
+      pthread_cond_broadcast(&group->condition);
+      pthread_mutex_unlock(&group->lock);
+      break;
+    }
+
+    pthread_attr_destroy(&attribute);
+  }
+
+  pthread_mutex_lock(&group->lock);
+
+  while (group->ready < group->count)
+  {
+    //
+    pthread_cond_wait(&group->condition, &group->lock);
+  }
+
+  pthread_mutex_unlock(&group->lock);
+
+  if (unlikely(atomic_load_explicit(&group->state, memory_order_acquire) != RING_GROUP_STATE_RUNNING))
+  {
+    ReleaseFastRingGroup(group);
+    return NULL;
+  }
+
+  return group;
+}
+
+void StopFastRingGroup(struct FastRingGroup* group)
+{
+  struct FastRingDescriptor* descriptor;
+  struct FastRingGroupShard* shard;
+  struct FastRing* ring;
+#ifdef RING_GROUP_FEATURE_SYNC_MESSAGE
+  struct io_uring_sqe submission;
+#endif
+  uint32_t index;
+
+  if ((group == NULL) ||
+      (atomic_exchange_explicit(&group->state, RING_GROUP_STATE_STOPPED, memory_order_acq_rel) != RING_GROUP_STATE_RUNNING))
+  {
+    // Group is already stopping
+    return;
+  }
+
+  // Wake up shards sleeping in WaitForFastRing(), lock keeps rings from being released meanwhile
+
+  pthread_mutex_lock(&group->lock);
+
+  for (index = 0; index < group->count; ++ index)
+  {
+    shard = group->shards + index;
+    ring  = shard->ring;
+
+    if ((ring    == NULL) ||
+        (current == shard))
+    {
+      //
+      continue;
+    }
+
+    if ((current        != NULL) &&
+        (current->group == group))
+    {
+      if (descriptor = AllocateFastRingDescriptor(current->ring, NULL, NULL))
+      {
+        io_uring_prep_msg_ring(&descriptor->submission, ring->ring.ring_fd, 0, RING_DATA_UNDEFINED, 0);
+        SubmitFastRingDescriptor(descriptor, 0);
+      }
+
+      continue;
+    }
+
+#ifdef RING_GROUP_FEATURE_SYNC_MESSAGE
+    io_uring_prep_msg_ring(&submission, ring->ring.ring_fd, 0, RING_DATA_UNDEFINED, 0);
+
+    if (io_uring_register_sync_msg(&submission) >= 0)
+    {
+      //
+      continue;
+    }
+#endif
+
+    // Kernel doesn't support synchronous messages, wake the shard up by its event file
+    eventfd_write(shard->handle, 1);
+  }
+
+  pthread_mutex_unlock(&group->lock);
+}
+
+void ReleaseFastRingGroup(struct FastRingGroup* group)
+{
+  uint32_t index;
+
+  if (group != NULL)
+  {
+    StopFastRingGroup(group);
+
+    for (index = 0; index < group->count; ++ index)
+    {
+      //
+      pthread_join(group->shards[index].thread, NULL);
+    }
+
+    pthread_cond_destroy(&group->condition);
+    pthread_mutex_destroy(&group->lock);
+    free(group);
+  }
+}
+
+struct FastRingGroupShard* GetFastRingGroupShard()
+{
+  return current;
+}
+
+struct FastRing* GetFastRingGroupRing(struct FastRingGroup* group, uint32_t index)
+{
+  if ((group != NULL) &&
+      (index <  group->count))
+  {
+    //
+    return group->shards[index].ring;
+  }
+
+  return NULL;
+}
+
+int SubmitFastRingGroupCall(struct FastRingGroup* group, uint32_t index, HandleFastRingCompletionFunction function, void* closure, uint32_t parameter)
+{
+  struct FastRingGroupShard* shard;
+  struct FastRingDescriptor* event;
+  struct FastRing* target;
+#ifdef RING_GROUP_FEATURE_SYNC_MESSAGE
+  struct io_uring_sqe submission;
+#endif
+  int result;
+
+  if (unlikely((group    == NULL) ||
+               (function == NULL) ||
+               (index    >= group->count)))
+  {
+    //
+    return -EINVAL;
+  }
+
+  shard = group->shards + index;
+
+  if ((current        != NULL) &&
+      (current->group == group) &&
+      (current->ring  != NULL))
+  {
+    // Shard to shard: rings are released only after all shards have stopped handling them,
+    // so the target is alive while the calling shard runs, message goes through the ring of calling shard
+
+    if (unlikely((atomic_load_explicit(&group->state, memory_order_acquire) != RING_GROUP_STATE_RUNNING) ||
+                 ((target = shard->ring) == NULL)))
+    {
+      //
+      return -ESHUTDOWN;
+    }
+
+    if (unlikely((event = CreateFastRingEvent(target, function, closure)) == NULL))
+    {
+      //
+      return -ENOMEM;
+    }
+
+    if (unlikely(SubmitFastRingEvent(current->ring, event, parameter, 0) < 0))
+    {
+      ReleaseFastRingDescriptor(event);
+      return -ENOMEM;
+    }
+
+    return 0;
+  }
+
+  // External thread: lock keeps the target from being released from the state check until the call is submitted,
+  // shard drains accepted calls after it has cleared its ring under the same lock
+
+  pthread_mutex_lock(&group->lock);
+
+  if (unlikely((atomic_load_explicit(&group->state, memory_order_acquire) != RING_GROUP_STATE_RUNNING) ||
+               ((target = shard->ring) == NULL)))
+  {
+    result = -ESHUTDOWN;
+    goto Leave;
+  }
+
+  if (unlikely((event = CreateFastRingEvent(target, function, closure)) == NULL))
+  {
+    result = -ENOMEM;
+    goto Leave;
+  }
+
+  result = 0;
+
+#ifdef RING_GROUP_FEATURE_SYNC_MESSAGE
+  io_uring_prep_msg_ring(&submission, target->ring.ring_fd, parameter, event->identifier, 0);
+
+  if (likely(io_uring_register_sync_msg(&submission) >= 0))
+  {
+    //
+    goto Leave;
+  }
+#endif
+
+  // Message is queued to the target ring itself, the event file wakes the shard up to submit it
+
+  if (unlikely(SubmitFastRingEvent(target, event, parameter, 0) < 0))
+  {
+    ReleaseFastRingDescriptor(event);
+    result = -ENOMEM;
+    goto Leave;
+  }
+
+  eventfd_write(shard->handle, 1);
+
+  Leave:
+
+  pthread_mutex_unlock(&group->lock);
+  return result;
+}
+
+int OpenFastRingGroupListener(struct FastRingGroupShard* shard, int type, struct sockaddr* address, socklen_t length, int backlog)
+{
+  int handle;
+  int value;
+
+  shard = shard ? shard : current;
+
+  if (unlikely(address == NULL))
+  {
+    //
+    return -EINVAL;
+  }
+
+  handle = socket(address->sa_family, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  value  = 1;
+
+  if (unlikely(handle < 0))
+  {
+    //
+    return -errno;
+  }
+
+  if (unlikely((setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(int)) < 0) ||
+               (setsockopt(handle, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(int)) < 0)))
+  {
+    //
+    goto Failure;
+  }
+
+#ifdef SO_INCOMING_CPU
+  if ((shard      != NULL) &&
+      (shard->cpu >= 0))
+  {
+    // Kernel prefers the listener of the shard running on CPU which handles the flow
+    setsockopt(handle, SOL_SOCKET, SO_INCOMING_CPU, &shard->cpu, sizeof(int));
+  }
+#endif
+
+  if (unlikely(bind(handle, address, length) < 0))
+  {
+    //
+    goto Failure;
+  }
+
+  type &= ~(SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+  if (((type == SOCK_STREAM) ||
+       (type == SOCK_SEQPACKET)) &&
+      (listen(handle, backlog) < 0))
+  {
+    //
+    goto Failure;
+  }
+
+  return handle;
+
+  Failure:
+
+  value = -errno;
+  close(handle);
+  return value;
+}
@@ -0,0 +1,73 @@
+#ifndef FASTRINGGROUP_H
+#define FASTRINGGROUP_H
+
+#include <sched.h>
+#include <sys/socket.h>
+
+#include "FastRing.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if (IO_URING_VERSION_MAJOR > 2) || (IO_URING_VERSION_MAJOR == 2) && (IO_URING_VERSION_MINOR >= 9)
+#define RING_GROUP_FEATURE_SYNC_MESSAGE  1
+#endif
+
+#define RING_GROUP_STATE_RUNNING  0
+#define RING_GROUP_STATE_STOPPED  1
+
+#define RING_GROUP_EVENT_START    0
+#define RING_GROUP_EVENT_STOP     1
+
+struct FastRingGroup;
+struct FastRingGroupShard;
+
+typedef void (*HandleFastRingGroupFunction)(struct FastRingGroupShard* shard, int event, void* closure);
+
+struct FastRingGroupShard
+{
+  struct FastRingGroup* group;                   // Owning group
+  struct FastRing* ring;                         // Ring of the shard (owned by shard's thread)
+  pthread_t thread;                              //
+  uint32_t index;                                // Index of the shard in the group
+  int cpu;                                       // CPU the thread is pinned to (negative - not pinned)
+  int node;                                      // NUMA node of the CPU
+  int handle;                                    // Event file read by the ring, external threads write to it to wake the shard up
+  void* data;                                    // User's per-shard data
+};
+
+struct FastRingGroup
+{
+  ATOMIC(uint32_t) state;                        // RING_GROUP_STATE_*
+  uint32_t count;                                // Count of shards
+  uint32_t interval;                             // Interval for WaitForFastRing
+  struct FastRingParameters parameters;          // Parameters for CreateFastRingEx
+
+  pthread_mutex_t lock;                          // Start and stop rendezvous of shards, keeps rings alive for external callers
+  pthread_cond_t condition;                      //
+  uint32_t ready;                                // Count of shards with created rings
+  uint32_t stopped;                              // Count of shards stopped handling their rings
+
+  HandleFastRingGroupFunction function;          // Handler of RING_GROUP_EVENT_*
+  void* closure;                                 // User's closure
+
+  struct FastRingGroupShard shards[0];
+};
+
+struct FastRingGroup* CreateFastRingGroup(uint32_t count, struct FastRingParameters* parameters, uint32_t interval, HandleFastRingGroupFunction function, void* closure);
+void StopFastRingGroup(struct FastRingGroup* group);
+void ReleaseFastRingGroup(struct FastRingGroup* group);
+
+struct FastRingGroupShard* GetFastRingGroupShard();
+struct FastRing* GetFastRingGroupRing(struct FastRingGroup* group, uint32_t index);
+
+int SubmitFastRingGroupCall(struct FastRingGroup* group, uint32_t index, HandleFastRingCompletionFunction function, void* closure, uint32_t parameter);
+int OpenFastRingGroupListener(struct FastRingGroupShard* shard, int type, struct sockaddr* address, socklen_t length, int backlog);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
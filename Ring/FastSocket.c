@@ -12,7 +12,8 @@
 
 static int HandleReleaseCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
 {
-  if (completion == NULL)
+  if ((completion == NULL) &&
+      (descriptor->submission.file_index == 0))
   {
     // Close operation has not been executed (ring teardown): the kernel closes
     // the descriptor on IORING_OP_CLOSE regardless of the reported result, so a
@@ -23,12 +24,34 @@ static int HandleReleaseCompletion(struct FastRingDescriptor* descriptor, struct
   return 0;
 }
 
+static void ReleaseSocketHandle(struct FastRing* ring, int handle, int mode)
+{
+  int value;
+
+  if (mode & FASTSOCKET_MODE_FIXED_FILE)
+  {
+    value = -1;
+    io_uring_register_files_update(&ring->ring, handle, &value, 1);
+    return;
+  }
+
+  close(handle);
+}
+
 static void FreeSocketInstance(struct FastSocket* socket, int reason)
 {
   struct FastBuffer* buffer;
+  struct FastSocketShare* share;
   struct FastRingDescriptor* descriptor;
   struct FastSocketOutboundBatch* batch;
 
+  if (share = socket->inbound.share)
+  {
+    share->usage -= socket->inbound.length;
+    share->count --;
+    ReleaseFastSocketShare(share);
+  }
+
   while (buffer = socket->inbound.tail)
   {
     socket->inbound.tail = buffer->next;
@@ -43,13 +66,23 @@ static void FreeSocketInstance(struct FastSocket* socket, int reason)
 
   if (descriptor = AllocateFastRingDescriptor(socket->ring, HandleReleaseCompletion, NULL))
   {
-    io_uring_prep_close(&descriptor->submission, socket->handle);
+    if (socket->outbound.mode & FASTSOCKET_MODE_FIXED_FILE)
+    {
+      // Direct descriptor has never been in the process table, only the slot has to be freed
+      io_uring_prep_close_direct(&descriptor->submission, socket->handle);
+    }
+    else
+    {
+      //
+      io_uring_prep_close(&descriptor->submission, socket->handle);
+    }
+
     SubmitFastRingDescriptor(descriptor, 0);
   }
   else
   {
     // Error may occure during allocation
-    close(socket->handle);
+    ReleaseSocketHandle(socket->ring, socket->handle, socket->outbound.mode);
   }
 
   free(socket);
@@ -66,6 +99,35 @@ static inline void __attribute__((always_inline)) ReleaseSocketInstance(struct F
   }
 }
 
+static inline int __attribute__((always_inline)) IsInboundQuotaExceeded(struct FastSocket* socket, int shift)
+{
+  struct FastSocketShare* share;
+
+  share = socket->inbound.share;
+
+  // Socket may hold more than its fair part of the budget while the budget is not used up,
+  // shift halves the thresholds to resume receive with hysteresis
+
+  return
+    (socket->inbound.length > (share->limit >> shift)) ||
+    (share->usage > (share->budget >> shift)) &&
+    (socket->inbound.length > ((share->budget / share->count) >> shift));
+}
+
+static void PauseInboundQueue(struct FastSocket* socket)
+{
+  struct FastRingDescriptor* descriptor;
+
+  // Cancellation terminates multishot receive with -ECANCELED, HandleInboundCompletion() doesn't re-arm it while the quota is exceeded
+
+  if (descriptor = AllocateFastRingDescriptor(socket->ring, NULL, NULL))
+  {
+    io_uring_prep_cancel64(&descriptor->submission, socket->inbound.descriptor->identifier, 0);
+    SubmitFastRingDescriptor(descriptor, 0);
+    socket->inbound.state |= FASTSOCKET_INBOUND_PAUSING;
+  }
+}
+
 static inline void __attribute__((always_inline)) CallHandlerFunction(struct FastSocket* socket, int event, int parameter)
 {
   if (likely(socket->function != NULL))
@@ -116,7 +178,6 @@ static inline struct FastSocketOutboundBatch* __attribute__((always_inline)) All
 
 static int HandleInboundCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
 {
-  uint8_t* data;
   struct FastSocket* socket;
   struct FastBuffer* buffer;
 
@@ -168,15 +229,18 @@ static int HandleInboundCompletion(struct FastRingDescriptor* descriptor, struct
   }
 
   if (likely((completion->res >= 0) &&
-             (data = GetFastRingBuffer(socket->inbound.provider, completion))))
+             (buffer = TakeProvidedFastBuffer(socket->inbound.provider, socket->inbound.pool, completion))))
   {
-    AdvanceFastRingBuffer(socket->inbound.provider, completion, AllocateRingFastBuffer, socket->inbound.pool);
-
-    buffer                     = FAST_BUFFER(data);
     buffer->length             =  completion->res;
     socket->inbound.length    +=  completion->res;
     socket->inbound.condition  = ~completion->flags;
 
+    if (socket->inbound.share != NULL)
+    {
+      //
+      socket->inbound.share->usage += completion->res;
+    }
+
     if (unlikely(socket->inbound.tail == NULL))
     {
       socket->inbound.tail = buffer;
@@ -191,6 +255,16 @@ static int HandleInboundCompletion(struct FastRingDescriptor* descriptor, struct
     CallHandlerFunction(socket, POLLIN, socket->inbound.length);
 
     socket->inbound.condition = 0;
+
+    if (unlikely((socket->inbound.share      != NULL) &&
+                 (socket->inbound.descriptor != NULL) &&
+                 (socket->inbound.state      == 0)    &&
+                 (completion->flags & IORING_CQE_F_MORE) &&
+                 (IsInboundQuotaExceeded(socket, 0))))
+    {
+      // Application doesn't keep up with the peer
+      PauseInboundQueue(socket);
+    }
   }
 
   if (unlikely(~completion->flags & IORING_CQE_F_MORE))
@@ -203,6 +277,17 @@ static int HandleInboundCompletion(struct FastRingDescriptor* descriptor, struct
       return 0;
     }
 
+    if (unlikely((socket->inbound.share != NULL) &&
+                 (IsInboundQuotaExceeded(socket, !!(socket->inbound.state & FASTSOCKET_INBOUND_PAUSING)))))
+    {
+      // Keep the descriptor until the application drains the queue (see ReleaseFastSocketQuota)
+      socket->inbound.state = FASTSOCKET_INBOUND_PAUSED;
+      socket->inbound.share->paused ++;
+      return 1;
+    }
+
+    socket->inbound.state = 0;
+
     // Eventually URing may release submission
     // Also this handles -ENOBUFS and -ECANCELED
     SubmitFastRingDescriptor(socket->inbound.descriptor, 0);
@@ -273,12 +358,12 @@ static int HandleOutboundCompletion(struct FastRingDescriptor* descriptor, struc
 
   if ((~descriptor->submission.flags & IOSQE_IO_LINK) &&
       ( socket->outbound.condition   & POLLOUT) &&
-      ( descriptor->data.number == 0ULL))
+      ( descriptor->data.outbound.number == 0ULL))
   {
     // In case of TCP the kernel may occupy a buffer for much longer,
     // notify handler once about accepted buffer as soon as possible
 
-    descriptor->data.number ++;
+    descriptor->data.outbound.number ++;
 
     if ( (batch  = socket->outbound.tail) &&
         ((batch != socket->outbound.head) ||
@@ -319,7 +404,14 @@ static int HandleOutboundCompletion(struct FastRingDescriptor* descriptor, struc
       case IORING_OP_SENDMSG:
       case IORING_OP_SENDMSG_ZC:
       case IORING_OP_WRITEV:
-        ReleaseFastBuffer(FAST_BUFFER(descriptor->data.socket.vector.iov_base));
+        if (unlikely(descriptor->data.outbound.flags & FASTSOCKET_OUTBOUND_CHAIN))
+        {
+          // Scatter-gather transmission (see TransmitFastSocketChain), the chain is kept in place of the buffer
+          ReleaseFastBufferChain((struct FastBufferChain*)descriptor->extension->socket.vector.iov_base);
+          break;
+        }
+
+        ReleaseFastBuffer(FAST_BUFFER(descriptor->extension->socket.vector.iov_base));
         break;
     }
 
@@ -351,8 +443,11 @@ struct FastSocket* CreateFastSocket(struct FastRing* ring, struct FastRingBuffer
 
     descriptor = socket->inbound.descriptor;
 
-    if (descriptor == NULL)
+    if ((descriptor == NULL) ||
+        (message    != NULL) &&
+        (GetFastRingDescriptorExtension(descriptor) == NULL))
     {
+      ReleaseFastRingDescriptor(descriptor);
       free(socket);
       return NULL;
     }
@@ -379,12 +474,13 @@ struct FastSocket* CreateFastSocket(struct FastRing* ring, struct FastRingBuffer
       goto Continue;
     }
 
-    memcpy(&descriptor->data.socket.message, message, sizeof(struct msghdr));
-    io_uring_prep_recvmsg_multishot(&descriptor->submission, handle, &descriptor->data.socket.message, flags);
+    memcpy(&descriptor->extension->socket.message, message, sizeof(struct msghdr));
+    io_uring_prep_recvmsg_multishot(&descriptor->submission, handle, &descriptor->extension->socket.message, flags);
 
     Continue:
 
     PrepareFastRingBuffer(socket->inbound.provider, &descriptor->submission);
+    descriptor->submission.flags |= IOSQE_FIXED_FILE * !!(mode & FASTSOCKET_MODE_FIXED_FILE);
     SubmitFastRingDescriptor(socket->inbound.descriptor, 0);
 
     if (descriptor = AllocateFastRingDescriptor(ring, NULL, NULL))
@@ -445,28 +541,22 @@ ssize_t ReceiveFastSocketData(struct FastSocket* socket, void* data, size_t size
     ReleaseFastBuffer(buffer);
   }
 
+  if (socket->inbound.share != NULL)
+  {
+    // Accounting of the share, receive may be resumed
+    ReleaseFastSocketQuota(socket, size);
+  }
+
   return size;
 }
 
-int TransmitFastSocketDescriptor(struct FastSocket* socket, struct FastRingDescriptor* descriptor, struct FastBuffer* buffer)
+static int EnqueueOutboundDescriptor(struct FastSocket* socket, struct FastRingDescriptor* descriptor, uint32_t flags)
 {
   struct FastSocketOutboundBatch* batch;
 
-  if (unlikely((socket     == NULL) ||
-               (descriptor == NULL) ||
-               (buffer     == NULL) &&
-               (descriptor->submission.opcode != IORING_OP_POLL_ADD) &&
-               (descriptor->submission.opcode != IORING_OP_URING_CMD)))
-  {
-    ReleaseFastRingDescriptor(descriptor);
-    ReleaseFastBuffer(buffer);
-    return -EINVAL;
-  }
-
   if (unlikely((socket->outbound.condition & POLLERR)))
   {
-    ReleaseFastRingDescriptor(descriptor);
-    ReleaseFastBuffer(buffer);
+    //
     return -EPIPE;
   }
 
@@ -474,15 +564,18 @@ int TransmitFastSocketDescriptor(struct FastSocket* socket, struct FastRingDescr
                  (batch->count < socket->outbound.limit) ||
                  (batch = AllocateOutboundBatch(&socket->outbound)))))
   {
-    ReleaseFastRingDescriptor(descriptor);
-    ReleaseFastBuffer(buffer);
+    //
     return -ENOMEM;
   }
 
-  descriptor->data.number        = 0ULL;
-  descriptor->function           = HandleOutboundCompletion;
-  descriptor->closure            = socket;
-  descriptor->submission.ioprio |= IORING_RECVSEND_POLL_FIRST *
+  descriptor->data.outbound.number  = 0ULL;
+  descriptor->data.outbound.flags   = flags;
+  descriptor->function              = HandleOutboundCompletion;
+  descriptor->closure               = socket;
+  descriptor->submission.flags     |= IOSQE_FIXED_FILE *
+    ((socket->outbound.mode & FASTSOCKET_MODE_FIXED_FILE) &&
+     (descriptor->submission.fd == socket->handle));
+  descriptor->submission.ioprio    |= IORING_RECVSEND_POLL_FIRST *
     ((descriptor->submission.opcode == IORING_OP_SEND)    ||
      (descriptor->submission.opcode == IORING_OP_SEND_ZC) ||
      (descriptor->submission.opcode == IORING_OP_SENDMSG) ||
@@ -519,6 +612,30 @@ int TransmitFastSocketDescriptor(struct FastSocket* socket, struct FastRingDescr
   return 0;
 }
 
+int TransmitFastSocketDescriptor(struct FastSocket* socket, struct FastRingDescriptor* descriptor, struct FastBuffer* buffer)
+{
+  int result;
+
+  if (unlikely((socket     == NULL) ||
+               (descriptor == NULL) ||
+               (buffer     == NULL) &&
+               (descriptor->submission.opcode != IORING_OP_POLL_ADD) &&
+               (descriptor->submission.opcode != IORING_OP_URING_CMD)))
+  {
+    ReleaseFastRingDescriptor(descriptor);
+    ReleaseFastBuffer(buffer);
+    return -EINVAL;
+  }
+
+  if (unlikely((result = EnqueueOutboundDescriptor(socket, descriptor, 0)) < 0))
+  {
+    ReleaseFastRingDescriptor(descriptor);
+    ReleaseFastBuffer(buffer);
+  }
+
+  return result;
+}
+
 int TransmitFastSocketMessage(struct FastSocket* socket, struct msghdr* message, int flags)
 {
   struct FastRingDescriptor* descriptor;
@@ -556,7 +673,10 @@ int TransmitFastSocketMessage(struct FastSocket* socket, struct msghdr* message,
   buffer     = AllocateFastBuffer(socket->outbound.pool, length + message->msg_controllen, 0);
 
   if (unlikely((descriptor == NULL) ||
-               (buffer     == NULL)))
+               (buffer     == NULL) ||
+               ((message->msg_namelen    != 0) ||
+                (message->msg_controllen != 0)) &&
+               (GetFastRingDescriptorExtension(descriptor) == NULL)))
   {
     ReleaseFastRingDescriptor(descriptor);
     ReleaseFastBuffer(buffer);
@@ -581,30 +701,31 @@ int TransmitFastSocketMessage(struct FastSocket* socket, struct msghdr* message,
 
     if (message->msg_namelen != 0)
     {
-      memcpy(&descriptor->data.socket.address, message->msg_name, message->msg_namelen);
-      io_uring_prep_send_set_addr(&descriptor->submission, (struct sockaddr*)&descriptor->data.socket.address, message->msg_namelen);
+      memcpy(&descriptor->extension->socket.address, message->msg_name, message->msg_namelen);
+      io_uring_prep_send_set_addr(&descriptor->submission, (struct sockaddr*)&descriptor->extension->socket.address, message->msg_namelen);
     }
   }
   else
   {
-    io_uring_prep_sendmsg(&descriptor->submission, socket->handle, &descriptor->data.socket.message, flags);
+    io_uring_prep_sendmsg(&descriptor->submission, socket->handle, &descriptor->extension->socket.message, flags);
     memcpy(pointer, message->msg_control, message->msg_controllen);
 
-    descriptor->submission.opcode                  += (IORING_OP_SENDMSG_ZC - IORING_OP_SENDMSG) * !!(socket->outbound.mode & MSG_ZEROCOPY);
-    descriptor->data.socket.vector.iov_base         = buffer->data;
-    descriptor->data.socket.vector.iov_len          = length;
-    descriptor->data.socket.message.msg_iov         = &descriptor->data.socket.vector;
-    descriptor->data.socket.message.msg_iovlen      = 1;
-    descriptor->data.socket.message.msg_name        = NULL;
-    descriptor->data.socket.message.msg_namelen     = 0;
-    descriptor->data.socket.message.msg_control     = pointer;
-    descriptor->data.socket.message.msg_controllen  = message->msg_controllen;
+    descriptor->submission.opcode                        += (IORING_OP_SENDMSG_ZC - IORING_OP_SENDMSG) * !!(socket->outbound.mode & MSG_ZEROCOPY);
+    descriptor->extension->socket.vector.iov_base         = buffer->data;
+    descriptor->extension->socket.vector.iov_len          = length;
+    descriptor->extension->socket.message.msg_iov         = &descriptor->extension->socket.vector;
+    descriptor->extension->socket.message.msg_iovlen      = 1;
+    descriptor->extension->socket.message.msg_name        = NULL;
+    descriptor->extension->socket.message.msg_namelen     = 0;
+    descriptor->extension->socket.message.msg_control     = pointer;
+    descriptor->extension->socket.message.msg_controllen  = message->msg_controllen;
+    descriptor->extension->socket.message.msg_flags       = 0;
 
     if (message->msg_namelen != 0)
     {
-      memcpy(&descriptor->data.socket.address, message->msg_name, message->msg_namelen);
-      descriptor->data.socket.message.msg_name    = &descriptor->data.socket.address;
-      descriptor->data.socket.message.msg_namelen = message->msg_namelen;
+      memcpy(&descriptor->extension->socket.address, message->msg_name, message->msg_namelen);
+      descriptor->extension->socket.message.msg_name    = &descriptor->extension->socket.address;
+      descriptor->extension->socket.message.msg_namelen = message->msg_namelen;
     }
   }
 
@@ -631,7 +752,9 @@ int TransmitFastSocketData(struct FastSocket* socket, struct sockaddr* address,
   buffer     = AllocateFastBuffer(socket->outbound.pool, size, 0);
 
   if (unlikely((descriptor == NULL) ||
-               (buffer     == NULL)))
+               (buffer     == NULL) ||
+               (length     != 0)    &&
+               (GetFastRingDescriptorExtension(descriptor) == NULL)))
   {
     ReleaseFastRingDescriptor(descriptor);
     ReleaseFastBuffer(buffer);
@@ -647,13 +770,161 @@ int TransmitFastSocketData(struct FastSocket* socket, struct sockaddr* address,
 
   if (length != 0)
   {
-    memcpy(&descriptor->data.socket.address, address, length);
-    io_uring_prep_send_set_addr(&descriptor->submission, (struct sockaddr*)&descriptor->data.socket.address, length);
+    memcpy(&descriptor->extension->socket.address, address, length);
+    io_uring_prep_send_set_addr(&descriptor->submission, (struct sockaddr*)&descriptor->extension->socket.address, length);
   }
 
   return TransmitFastSocketDescriptor(socket, descriptor, buffer);
 }
 
+int TransmitFastSocketChain(struct FastSocket* socket, struct sockaddr* address, socklen_t length, struct FastBufferChain* chain, int flags)
+{
+  struct FastRingDescriptor* descriptor;
+  int result;
+
+  if (unlikely((socket   == NULL) ||
+               (chain    == NULL) ||
+               (chain->number == 0) ||
+               (length   != 0)    &&
+               ((address == NULL) ||
+                (length   > sizeof(struct sockaddr_storage)))))
+  {
+    ReleaseFastBufferChain(chain);
+    return -EINVAL;
+  }
+
+  descriptor = AllocateFastRingDescriptor(socket->ring, NULL, NULL);
+
+  if (unlikely((descriptor == NULL) ||
+               (GetFastRingDescriptorExtension(descriptor) == NULL)))
+  {
+    ReleaseFastRingDescriptor(descriptor);
+    ReleaseFastBufferChain(chain);
+    return -ENOMEM;
+  }
+
+  // Slices go to the kernel as they are, nothing is copied, the chain is released on completion (see HandleOutboundCompletion)
+
+  descriptor->extension->socket.vector.iov_base         = chain;
+  descriptor->extension->socket.vector.iov_len          = chain->length;
+  descriptor->extension->socket.message.msg_iov         = chain->vectors;
+  descriptor->extension->socket.message.msg_iovlen      = chain->number;
+  descriptor->extension->socket.message.msg_name        = NULL;
+  descriptor->extension->socket.message.msg_namelen     = 0;
+  descriptor->extension->socket.message.msg_control     = NULL;
+  descriptor->extension->socket.message.msg_controllen  = 0;
+  descriptor->extension->socket.message.msg_flags       = 0;
+
+  if (length != 0)
+  {
+    memcpy(&descriptor->extension->socket.address, address, length);
+    descriptor->extension->socket.message.msg_name    = &descriptor->extension->socket.address;
+    descriptor->extension->socket.message.msg_namelen = length;
+  }
+
+  if (socket->outbound.mode & MSG_DONTROUTE)
+  {
+    // File I/O mode, offset -1 means the current file position
+    io_uring_prep_writev(&descriptor->submission, socket->handle, chain->vectors, chain->number, -1);
+  }
+  else
+  {
+    io_uring_prep_sendmsg(&descriptor->submission, socket->handle, &descriptor->extension->socket.message, flags);
+    descriptor->submission.opcode += (IORING_OP_SENDMSG_ZC - IORING_OP_SENDMSG) * !!(socket->outbound.mode & MSG_ZEROCOPY);
+  }
+
+  if (unlikely((result = EnqueueOutboundDescriptor(socket, descriptor, FASTSOCKET_OUTBOUND_CHAIN)) < 0))
+  {
+    ReleaseFastRingDescriptor(descriptor);
+    ReleaseFastBufferChain(chain);
+  }
+
+  return result;
+}
+
+ssize_t ReceiveFastSocketChain(struct FastSocket* socket, struct FastBufferChain* chain, size_t size, int flags)
+{
+  struct FastBuffer* current;
+  struct FastBuffer* buffer;
+  size_t position;
+  size_t count;
+  size_t rest;
+
+  if (unlikely((socket == NULL) ||
+               (chain  == NULL) ||
+               (size   == 0)))
+  {
+    // Cannot proceed a call
+    return -EINVAL;
+  }
+
+  if (unlikely((socket->inbound.length == 0) ||
+               (socket->inbound.length < size) &&
+               (flags & MSG_WAITALL)))
+  {
+    // Insufficient length
+    return 0;
+  }
+
+  size     = (socket->inbound.length < size) ? socket->inbound.length : size;
+  count    = size;
+  buffer   = socket->inbound.tail;
+  position = socket->inbound.position;
+
+  // Slices hold references to inbound buffers, so the data is handed out across buffer boundaries without copying
+
+  while (count > 0)
+  {
+    rest = buffer->length - position;
+    rest = (count < rest) ? count : rest;
+
+    if (unlikely(AppendFastBufferChain(chain, buffer, position, rest) < 0))
+    {
+      // Chain is full, the view is shorter than requested
+      break;
+    }
+
+    count    -= rest;
+    position += rest;
+
+    if (position == buffer->length)
+    {
+      buffer   = buffer->next;
+      position = 0;
+    }
+  }
+
+  size -= count;
+
+  if (unlikely(size == 0))
+  {
+    //
+    return -ENOSPC;
+  }
+
+  if (~flags & MSG_PEEK)
+  {
+    // Buffers passed entirely are dropped from the queue, the chain keeps them alive
+
+    while ((current = socket->inbound.tail) != buffer)
+    {
+      socket->inbound.tail = current->next;
+      ReleaseFastBuffer(current);
+    }
+
+    socket->inbound.position  = position;
+    socket->inbound.length   -= size;
+
+    if (socket->inbound.share != NULL)
+    {
+      // Accounting of the share, receive may be resumed
+      ReleaseFastSocketQuota(socket, size);
+    }
+  }
+
+  return size;
+}
+
 void ReleaseFastSocket(struct FastSocket* socket)
 {
   struct FastRingDescriptor* descriptor;
@@ -668,6 +939,17 @@ void ReleaseFastSocket(struct FastSocket* socket)
       socket->inbound.descriptor = NULL;
     }
 
+    if ((descriptor = socket->inbound.descriptor) &&
+        (socket->inbound.state & FASTSOCKET_INBOUND_PAUSED))
+    {
+      // Paused receive is neither queued nor submitted
+      socket->inbound.share->paused --;
+      socket->inbound.descriptor = NULL;
+      socket->inbound.state      = 0;
+      ReleaseFastRingDescriptor(descriptor);
+      socket->count --;
+    }
+
     if ((descriptor = socket->inbound.descriptor) &&
         (atomic_load_explicit(&descriptor->state, memory_order_relaxed) == RING_DESC_STATE_PENDING))
     {
@@ -694,6 +976,159 @@ void ReleaseFastSocket(struct FastSocket* socket)
   }
 }
 
+struct FastSocketShare* CreateFastSocketShare(struct FastRingBufferProvider* provider, size_t budget, size_t limit)
+{
+  struct FastSocketShare* share;
+
+  if (likely((provider != NULL) &&
+             (budget   != 0)    &&
+             (share     = (struct FastSocketShare*)calloc(1, sizeof(struct FastSocketShare)))))
+  {
+    share->provider   = provider;
+    share->budget     = budget;
+    share->limit      = ((limit != 0) && (limit < budget)) ? limit : budget;
+    share->references = 1;
+    return share;
+  }
+
+  return NULL;
+}
+
+void ReleaseFastSocketShare(struct FastSocketShare* share)
+{
+  if ((share != NULL) &&
+      (-- share->references == 0))
+  {
+    // Attached sockets keep the share until they are freed
+    free(share);
+  }
+}
+
+int SetFastSocketShare(struct FastSocket* socket, struct FastSocketShare* share)
+{
+  if (unlikely((socket == NULL) ||
+               (share  == NULL) ||
+               (socket->inbound.share    != NULL) ||
+               (socket->inbound.provider != share->provider)))
+  {
+    // Cannot proceed a call
+    return -EINVAL;
+  }
+
+  share->references ++;
+  share->count      ++;
+  share->usage      += socket->inbound.length;
+
+  socket->inbound.share = share;
+  return 0;
+}
+
+void ReleaseFastSocketQuota(struct FastSocket* socket, size_t length)
+{
+  struct FastSocketShare* share;
+
+  share         = socket->inbound.share;
+  share->usage -= length;
+
+  if (unlikely((socket->inbound.state & FASTSOCKET_INBOUND_PAUSED) &&
+               (!IsInboundQuotaExceeded(socket, 1))))
+  {
+    socket->inbound.state = 0;
+    share->paused --;
+    SubmitFastRingDescriptor(socket->inbound.descriptor, 0);
+  }
+}
+
+struct FastRingDescriptor* AcceptFastSocketDirect(struct FastRing* ring, int handle, HandleFastRingCompletionFunction function, void* closure)
+{
+  struct FastRingDescriptor* descriptor;
+
+  if (likely((ring     != NULL) &&
+             (function != NULL) &&
+             (descriptor = AllocateFastRingDescriptor(ring, function, closure))))
+  {
+    // Every CQE carries a new fixed-file index, function has to re-submit the descriptor once IORING_CQE_F_MORE is gone
+    io_uring_prep_multishot_accept_direct(&descriptor->submission, handle, NULL, NULL, 0);
+    SubmitFastRingDescriptor(descriptor, 0);
+    return descriptor;
+  }
+
+  return NULL;
+}
+
+static int HandleConnectCompletion(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
+{
+  struct FastRingDescriptor* other;
+  struct FastRingSocketData* data;
+
+  data = &descriptor->extension->socket;
+
+  if (likely((completion != NULL) &&
+             (completion->res >= 0) &&
+             (descriptor->submission.opcode == IORING_OP_SOCKET)))
+  {
+    // Socket is installed into the table of registered files, connect it by the allocated index
+    io_uring_initialize_sqe(&descriptor->submission);
+    io_uring_prep_connect(&descriptor->submission, completion->res, (struct sockaddr*)&data->address, data->length);
+    descriptor->submission.flags |= IOSQE_FIXED_FILE;
+    SubmitFastRingDescriptor(descriptor, 0);
+    return 1;
+  }
+
+  if (unlikely((completion      != NULL) &&
+               (completion->res <  0)    &&
+               (descriptor->submission.opcode == IORING_OP_CONNECT)))
+  {
+    if (other = AllocateFastRingDescriptor(descriptor->ring, NULL, NULL))
+    {
+      io_uring_prep_close_direct(&other->submission, descriptor->submission.fd);
+      SubmitFastRingDescriptor(other, 0);
+    }
+    else
+    {
+      //
+      ReleaseSocketHandle(descriptor->ring, descriptor->submission.fd, FASTSOCKET_MODE_FIXED_FILE);
+    }
+  }
+
+  descriptor->function     = (HandleFastRingCompletionFunction)descriptor->data.pointer;
+  descriptor->data.pointer = NULL;
+  return descriptor->function(descriptor, completion, reason);
+}
+
+int ConnectFastSocketDirect(struct FastRing* ring, int domain, int type, int protocol, struct sockaddr* address, socklen_t length, HandleFastRingCompletionFunction function, void* closure)
+{
+  struct FastRingDescriptor* descriptor;
+
+  if (unlikely((ring     == NULL) ||
+               (function == NULL) ||
+               (address  == NULL) ||
+               (length   >  sizeof(struct sockaddr_storage))))
+  {
+    // Cannot proceed a call
+    return -EINVAL;
+  }
+
+  if (unlikely(((descriptor = AllocateFastRingDescriptor(ring, HandleConnectCompletion, closure)) == NULL) ||
+               (GetFastRingDescriptorExtension(descriptor) == NULL)))
+  {
+    ReleaseFastRingDescriptor(descriptor);
+    return -ENOMEM;
+  }
+
+  // Connect is submitted from the completion of socket, so function gets the result of connect
+  // (or socket when it fails) with descriptor->submission.fd holding the fixed-file index,
+  // function is kept in the data of descriptor since extension outlives the descriptor's recycling
+
+  memcpy(&descriptor->extension->socket.address, address, length);
+  descriptor->extension->socket.length = length;
+  descriptor->data.pointer             = (void*)function;
+
+  io_uring_prep_socket_direct_alloc(&descriptor->submission, domain, type, protocol, 0);
+  SubmitFastRingDescriptor(descriptor, 0);
+  return 0;
+}
+
 static ssize_t HandleStreamRead(void* cookie, char* data, size_t size)
 {
   int result;
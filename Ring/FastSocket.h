@@ -15,22 +15,43 @@ extern "C"
 #define FASTSOCKET_MODE_ZERO_COPY  MSG_ZEROCOPY
 #define FASTSOCKET_MODE_AUTO_CORK  MSG_MORE
 
+#define FASTSOCKET_MODE_FIXED_FILE MSG_PROXY
+
 #if (IO_URING_VERSION_MAJOR > 2) || (IO_URING_VERSION_MAJOR == 2) && (IO_URING_VERSION_MINOR >= 6)
 #define FASTSOCKET_MODE_FILE_IO    MSG_DONTROUTE
 #endif
 
+#define FASTSOCKET_INBOUND_PAUSING  (1 << 0)
+#define FASTSOCKET_INBOUND_PAUSED   (1 << 1)
+
+#define FASTSOCKET_OUTBOUND_CHAIN   (1 << 0)
+
 struct FastSocket;
+struct FastSocketShare;
 
 typedef void (*HandleFastSocketEvent)(struct FastSocket* socket, int event, int parameter);
 
+struct FastSocketShare
+{
+  struct FastRingBufferProvider* provider;
+  size_t budget;
+  size_t limit;
+  size_t usage;
+  uint32_t count;
+  uint32_t paused;
+  int references;
+};
+
 struct FastSocketInboundQueue
 {
   struct FastRingBufferProvider* provider;
   struct FastRingDescriptor* descriptor;
+  struct FastSocketShare* share;
   struct FastBufferPool* pool;
   struct FastBuffer* head;
   struct FastBuffer* tail;
   uint32_t condition;
+  uint32_t state;
   size_t position;
   size_t length;
 };
@@ -73,14 +94,35 @@ int TransmitFastSocketMessage(struct FastSocket* socket, struct msghdr* message,
 int TransmitFastSocketData(struct FastSocket* socket, struct sockaddr* address, socklen_t length, const void* data, size_t size, int flags);
 void ReleaseFastSocket(struct FastSocket* socket);
 
+// Chain: TransmitFastSocketChain takes over the caller's reference and sends all slices by one sendmsg() / SEND_ZC (writev() in file I/O mode),
+// ReceiveFastSocketChain appends slices of inbound buffers to the chain instead of copying (MSG_PEEK keeps them in the queue)
+
+int TransmitFastSocketChain(struct FastSocket* socket, struct sockaddr* address, socklen_t length, struct FastBufferChain* chain, int flags);
+ssize_t ReceiveFastSocketChain(struct FastSocket* socket, struct FastBufferChain* chain, size_t size, int flags);
+
 FILE* GetFastSocketStream(struct FastSocket* socket, int own);
 
+// Share: sockets of one provider hold inbound data within a common budget, receive of a socket exceeding its quota
+// is paused until the application drains the queue (ReleaseFastSocketQuota is called by Receive functions)
+
+struct FastSocketShare* CreateFastSocketShare(struct FastRingBufferProvider* provider, size_t budget, size_t limit);
+void ReleaseFastSocketShare(struct FastSocketShare* share);
+int SetFastSocketShare(struct FastSocket* socket, struct FastSocketShare* share);
+void ReleaseFastSocketQuota(struct FastSocket* socket, size_t length);
+
+// Direct descriptors: sockets are allocated by kernel in the upper half of the table of registered files
+// (see FastRing's Registered File API), completion->res of accept and descriptor->submission.fd of connect
+// are fixed-file indexes suitable for FASTSOCKET_MODE_FIXED_FILE
+
+struct FastRingDescriptor* AcceptFastSocketDirect(struct FastRing* ring, int handle, HandleFastRingCompletionFunction function, void* closure);
+int ConnectFastSocketDirect(struct FastRing* ring, int domain, int type, int protocol, struct sockaddr* address, socklen_t length, HandleFastRingCompletionFunction function, void* closure);
+
 inline __attribute__((always_inline)) struct msghdr* GetFastSocketMessageHeader(struct FastSocket* socket)
 {
   return ((socket != NULL) &&
           (socket->inbound.descriptor != NULL) &&
           (socket->inbound.descriptor->submission.opcode == IORING_OP_RECVMSG)) ?
-         &socket->inbound.descriptor->data.socket.message :
+         &socket->inbound.descriptor->extension->socket.message :
          NULL;
 }
 
@@ -93,6 +135,13 @@ inline __attribute__((always_inline)) struct FastBuffer* ReceiveFastSocketBuffer
   {
     socket->inbound.tail     = buffer->next;
     socket->inbound.length  -= buffer->length - socket->inbound.position;
+
+    if (socket->inbound.share != NULL)
+    {
+      // Accounting of the share, receive may be resumed
+      ReleaseFastSocketQuota(socket, buffer->length - socket->inbound.position);
+    }
+
     socket->inbound.position = 0;
     return buffer;
   }
@@ -31,7 +31,7 @@ static void HandleDescriptorChange(struct smb2_context* context, t_socket handle
     {
       case SMB2_ADD_FD:
         mask  = smb2_which_events(context);
-        mask |= (mask != 0ULL) * (RING_POLL_ERROR | RING_POLL_HANGUP | RING_POLL_SHOT | RING_POLL_REPEAT);
+        mask |= (mask != 0ULL) * (RING_POLL_ERROR | RING_POLL_HANGUP | RING_POLL_LEVEL | RING_POLL_PROBE);
         SetFastRingPoll(opaque->ring, handle, mask, HandlePollEvent, context);
         return;
 
@@ -50,7 +50,7 @@ static void HandleEventChange(struct smb2_context* context, t_socket handle, int
   if (opaque = (struct SambarOpaque*)smb2_get_opaque(context))
   {
     mask  = events;
-    mask |= (mask != 0ULL) * (RING_POLL_ERROR | RING_POLL_HANGUP | RING_POLL_SHOT | RING_POLL_REPEAT);
+    mask |= (mask != 0ULL) * (RING_POLL_ERROR | RING_POLL_HANGUP | RING_POLL_LEVEL | RING_POLL_PROBE);
     SetFastRingPoll(opaque->ring, handle, mask, HandlePollEvent, context);
   }
 }
@@ -70,7 +70,7 @@ void AttachSambarOpaque(struct SambarOpaque* opaque, struct FastRing* ring, stru
   {
     handle  = smb2_get_fd(context);
     mask    = smb2_which_events(context);
-    mask   |= (mask != 0ULL) * (RING_POLL_ERROR | RING_POLL_HANGUP | RING_POLL_SHOT | RING_POLL_REPEAT);
+    mask   |= (mask != 0ULL) * (RING_POLL_ERROR | RING_POLL_HANGUP | RING_POLL_LEVEL | RING_POLL_PROBE);
     SetFastRingPoll(opaque->ring, handle, mask, HandlePollEvent, context);
   }
 }
@@ -125,7 +125,7 @@ static int HandleAcceptCompletion(struct FastRingDescriptor* descriptor, struct
       }
     }
 
-    descriptor->data.socket.length = sizeof(struct sockaddr_storage);
+    descriptor->extension->socket.length = sizeof(struct sockaddr_storage);
     SubmitFastRingDescriptor(descriptor, 0);
     return 1;
   }
@@ -147,6 +147,7 @@ struct SambarListener* OpenSambarListener(struct FastRing* ring, uint16_t port,
     address.sin6_family = AF_INET6;
     address.sin6_port   = htons(port);
     value               = 1;
+    descriptor          = NULL;
 
     listener->handle = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, IPPROTO_TCP);
 
@@ -157,8 +158,10 @@ struct SambarListener* OpenSambarListener(struct FastRing* ring, uint16_t port,
         (setsockopt(listener->handle, IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, sizeof(int)) < 0) ||
         (bind(listener->handle, (struct sockaddr*)&address, sizeof(struct sockaddr_in6))  < 0) ||
         (listen(listener->handle, SOMAXCONN) < 0)                                              ||
-        !(descriptor = AllocateFastRingDescriptor(ring, HandleAcceptCompletion, listener)))
+        !(descriptor = AllocateFastRingDescriptor(ring, HandleAcceptCompletion, listener)) ||
+        !(GetFastRingDescriptorExtension(descriptor)))
     {
+      ReleaseFastRingDescriptor(descriptor);
       close(listener->handle);
       free(listener);
       return NULL;
@@ -168,8 +171,8 @@ struct SambarListener* OpenSambarListener(struct FastRing* ring, uint16_t port,
     listener->function = function;
     listener->accept   = descriptor;
 
-    descriptor->data.socket.length = sizeof(struct sockaddr_storage);
-    io_uring_prep_accept(&descriptor->submission, listener->handle, (struct sockaddr*)&descriptor->data.socket.address, &descriptor->data.socket.length, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    descriptor->extension->socket.length = sizeof(struct sockaddr_storage);
+    io_uring_prep_accept(&descriptor->submission, listener->handle, (struct sockaddr*)&descriptor->extension->socket.address, &descriptor->extension->socket.length, SOCK_CLOEXEC | SOCK_NONBLOCK);
     SubmitFastRingDescriptor(descriptor, 0);
   }
 
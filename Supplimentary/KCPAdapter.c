@@ -10,7 +10,7 @@
 #include <linux/net_tstamp.h>
 
 #define INBOUND_COUNT   2048
-#define INBOUND_LENGTH  2048
+#define INBOUND_LENGTH  (2048 - sizeof(struct FastBuffer))  // Buffer with its header fills the 2 KB size class
 #define CONTROL_LENGTH  256
 
 static void StoreTimeDifference(struct KCPAdapter* adapter)
@@ -153,20 +153,28 @@ static int TransmitServicePacket(void* closure, struct sockaddr* address, uint8_
   socket  = adapter->socket;
   buffer  = HoldFastBuffer(FAST_BUFFER(data));
 
-  if (descriptor = AllocateFastRingDescriptor(socket->ring, NULL, NULL))
+  if ((descriptor = AllocateFastRingDescriptor(socket->ring, NULL, NULL)) &&
+      (GetFastRingDescriptorExtension(descriptor) == NULL))
+  {
+    // Socket address is kept in side allocation
+    ReleaseFastRingDescriptor(descriptor);
+    descriptor = NULL;
+  }
+
+  if (descriptor != NULL)
   {
     io_uring_prep_send_zc(&descriptor->submission, socket->handle, data, size, 0, 0);
 
     switch (address->sa_family)
     {
       case AF_INET:
-        memcpy(&descriptor->data.socket.address, address, sizeof(struct sockaddr_in));
-        io_uring_prep_send_set_addr(&descriptor->submission, (struct sockaddr*)&descriptor->data.socket.address, sizeof(struct sockaddr_in));
+        memcpy(&descriptor->extension->socket.address, address, sizeof(struct sockaddr_in));
+        io_uring_prep_send_set_addr(&descriptor->submission, (struct sockaddr*)&descriptor->extension->socket.address, sizeof(struct sockaddr_in));
         break;
 
       case AF_INET6:
-        memcpy(&descriptor->data.socket.address, address, sizeof(struct sockaddr_in6));
-        io_uring_prep_send_set_addr(&descriptor->submission, (struct sockaddr*)&descriptor->data.socket.address, sizeof(struct sockaddr_in6));
+        memcpy(&descriptor->extension->socket.address, address, sizeof(struct sockaddr_in6));
+        io_uring_prep_send_set_addr(&descriptor->submission, (struct sockaddr*)&descriptor->extension->socket.address, sizeof(struct sockaddr_in6));
         break;
     }
   }
@@ -240,7 +248,7 @@ struct KCPAdapter* CreateKCPAdapter(struct FastRing* ring, struct KCPService* se
 
     adapter->inbound  = CreateFastBufferPool(ring);
     adapter->outbound = CreateFastBufferPool(ring);
-    adapter->provider = CreateFastRingBufferProvider(ring, 0, INBOUND_COUNT, INBOUND_LENGTH, AllocateRingFastBuffer, adapter->inbound);
+    adapter->provider = CreateFastRingBufferProviderEx(ring, 0, INBOUND_COUNT, INBOUND_LENGTH, RING_BUFFER_FLAG_ADAPTIVE, AllocateRingFastBuffer, ReleaseRingFastBuffer, adapter->inbound);
     adapter->socket   = CreateFastSocket(ring, adapter->provider, adapter->inbound, adapter->outbound, handle, &adapter->message, 0, FASTSOCKET_MODE_ZERO_COPY, 0, HandleSocketEvent, adapter);
     adapter->timeout  = SetFastRingTimeout(ring, NULL, service->congestion.interval, TIMEOUT_FLAG_REPEAT, HandleTimeoutEvent, adapter);
 
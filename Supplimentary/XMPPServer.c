@@ -11,8 +11,10 @@
 #include <netinet/tcp.h>
 
 #define BUFFER_ALLIGNMENT   2048
-#define INBOUND_LENGTH      2048
+#define INBOUND_LENGTH      (2048 - sizeof(struct FastBuffer))  // Buffer with its header fills the 2 KB size class
 #define INBOUND_COUNT       2048
+#define INBOUND_BUDGET      (INBOUND_COUNT * INBOUND_LENGTH)
+#define INBOUND_QUOTA       (64 * 1024)
 #define POLL_INTERVAL       5000  // milliseconds
 #define CONNECTION_TIMEOUT  60    // seconds
 
@@ -328,8 +330,10 @@ static int CreateConnection(struct XMPPServer* server, int handle, struct sockad
 
   if ((connection         = (struct XMPPConnection*)calloc(1, sizeof(struct XMPPConnection))) &&
       (connection->parser = xmlCreatePushParserCtxt(&server->handler, connection, NULL, 0, NULL)) &&
-      (connection->socket = CreateFastSocket(server->ring, server->provider, server->inbound, server->outbound, handle, NULL, 0, FASTSOCKET_MODE_ZERO_COPY, 0, HandleSocket, connection)))
+      (connection->socket = CreateFastSocket(server->ring, server->provider, server->inbound, server->outbound, handle, NULL, 0, FASTSOCKET_MODE_ZERO_COPY | FASTSOCKET_MODE_FIXED_FILE, 0, HandleSocket, connection)))
   {
+    SetFastSocketShare(connection->socket, server->share);
+
     if (linked = server->connections)
     {
       connection->next = linked;
@@ -386,14 +390,17 @@ static void RejectConnection(struct XMPPServer* server, int handle)
 {
   struct FastRingDescriptor* descriptor;
 
+  int value;
+
   if (descriptor = AllocateFastRingDescriptor(server->ring, NULL, NULL))
   {
-    io_uring_prep_close(&descriptor->submission, handle);
+    io_uring_prep_close_direct(&descriptor->submission, handle);
     SubmitFastRingDescriptor(descriptor, 0);
     return;
   }
 
-  close(handle);
+  value = -1;
+  io_uring_register_files_update(&server->ring->ring, handle, &value, 1);
 }
 
 static int HandleConnection(struct FastRingDescriptor* descriptor, struct io_uring_cqe* completion, int reason)
@@ -404,16 +411,16 @@ static int HandleConnection(struct FastRingDescriptor* descriptor, struct io_uri
   if ((completion != NULL) &&
       (server      = (struct XMPPServer*)descriptor->closure))
   {
-    parameter.address = (struct sockaddr*)&descriptor->data.socket.address;
+    parameter.address = (struct sockaddr*)&descriptor->extension->socket.address;
     if ((completion->res >= 0) &&
         ((server->function(server, NULL, XMPP_EVENT_CONNECTION_ACCEPT, &parameter) < 0) ||
-         (CreateConnection(server, completion->res, (struct sockaddr*)&descriptor->data.socket.address, descriptor->data.socket.length) < 0)))
+         (CreateConnection(server, completion->res, (struct sockaddr*)&descriptor->extension->socket.address, descriptor->extension->socket.length) < 0)))
     {
       //
       RejectConnection(server, completion->res);
     }
 
-    descriptor->data.socket.length = sizeof(struct sockaddr_storage);
+    descriptor->extension->socket.length = sizeof(struct sockaddr_storage);
     SubmitFastRingDescriptor(descriptor, 0);
     return 1;
   }
@@ -489,14 +496,17 @@ struct XMPPServer* CreateXMPPServer(struct FastRing* ring, HandleXMPPEvent funct
 
     server->inbound  = CreateFastBufferPool(ring);
     server->outbound = CreateFastBufferPool(ring);
-    server->provider = CreateFastRingBufferProvider(ring, 0, INBOUND_COUNT, INBOUND_LENGTH, AllocateRingFastBuffer, server->inbound);
+    server->provider = CreateFastRingBufferProviderEx(ring, 0, INBOUND_COUNT, INBOUND_LENGTH, RING_BUFFER_FLAG_INCREMENTAL | RING_BUFFER_FLAG_ADAPTIVE, AllocateRingFastBuffer, ReleaseRingFastBuffer, server->inbound);
+    server->share    = CreateFastSocketShare(server->provider, INBOUND_BUDGET, INBOUND_QUOTA);
     server->listner  = AllocateFastRingDescriptor(ring, HandleConnection, server);
     server->timeout  = SetFastRingTimeout(ring, NULL, POLL_INTERVAL, TIMEOUT_FLAG_REPEAT, HandleTimeout, server);
 
-    if (descriptor = server->listner)
+    if ((descriptor = server->listner) &&
+        (GetFastRingDescriptorExtension(descriptor)))
     {
-      descriptor->data.socket.length = sizeof(struct sockaddr_storage);
-      io_uring_prep_accept(&descriptor->submission, server->handle, (struct sockaddr*)&descriptor->data.socket.address, &descriptor->data.socket.length, 0);
+      // Connections live in the table of registered files only, single-shot accept keeps the address of peer
+      descriptor->extension->socket.length = sizeof(struct sockaddr_storage);
+      io_uring_prep_accept_direct(&descriptor->submission, server->handle, (struct sockaddr*)&descriptor->extension->socket.address, &descriptor->extension->socket.length, 0, IORING_FILE_INDEX_ALLOC);
       SubmitFastRingDescriptor(descriptor, 0);
     }
   }
@@ -524,6 +534,7 @@ void ReleaseXMPPServer(struct XMPPServer* server)
     }
 
     SetFastRingTimeout(server->ring, server->timeout, -1, 0, NULL, NULL);
+    ReleaseFastSocketShare(server->share);
     ReleaseFastRingBufferProvider(server->provider, ReleaseRingFastBuffer);
     ReleaseFastBufferPool(server->outbound);
     ReleaseFastBufferPool(server->inbound);
@@ -88,6 +88,7 @@ struct XMPPServer
   struct FastBufferPool* inbound;
   struct FastBufferPool* outbound;
   struct FastRingBufferProvider* provider;
+  struct FastSocketShare* share;
 
   struct FastRingDescriptor* listner;
   struct FastRingDescriptor* timeout;